@@ -1,9 +1,26 @@
 #include "material_x_3d.h"
+#include "material_x_bake_worker.h"
+#include "material_x_godot_shader_generator.h"
+#include "material_x_import_cache.h"
+#include "material_x_library.h"
+#include "material_x_material_collection.h"
+#include "material_x_shader_cache.h"
+#include "material_x_texture_cache.h"
+#include "material_x_texture_streamer.h"
 
 #include "core/config/project_settings.h"
 #include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/io/resource_saver.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
 #include "modules/tinyexr/image_loader_tinyexr.h"
 
+// Baked images shared by all materials, stored by content.
+static const char *MTLX_BAKED_IMAGE_FOLDER = "res://.godot/imported/materialx_images/";
+// Bake results of graph outputs, keyed by their upstream graph and inputs.
+static const char *MTLX_BAKE_CACHE_FOLDER = "res://.godot/imported/materialx_bake_cache/";
+
 mx::FileSearchPath getDefaultSearchPath(mx::GenContext context) {
 	mx::FilePath modulePath = mx::FilePath::getModulePath();
 	mx::FilePath installRootPath = modulePath.getParentPath();
@@ -59,7 +76,7 @@ void applyModifiers(mx::DocumentPtr doc, const DocumentModifiers &modifiers) {
 						doc->getMatchingNodeDefs(nodeDef->getNodeString());
 				for (mx::NodeDefPtr altNodeDef : altNodeDefs) {
 					if (altNodeDef->getImplementation()) {
-						shader->setNodeDefString(altNodeDef->getName());
+						shader->setNodeDefString(shader->getReferenceName(altNodeDef));
 					}
 				}
 			}
@@ -69,6 +86,9 @@ void applyModifiers(mx::DocumentPtr doc, const DocumentModifiers &modifiers) {
 
 Variant get_value_as_material_x_variant(mx::InputPtr p_input) {
 	mx::ValuePtr value = p_input->getValue();
+	if (!value) {
+		return Variant();
+	}
 	if (value->getTypeString() == "float") {
 		return value->asA<float>();
 	} else if (value->getTypeString() == "integer") {
@@ -100,7 +120,97 @@ Variant get_value_as_material_x_variant(mx::InputPtr p_input) {
 	return Variant();
 }
 
-Error load_mtlx_document(mx::DocumentPtr p_doc, String p_path, mx::GenContext context) {
+void collect_image_dependencies(mx::DocumentPtr p_doc, const mx::FileSearchPath &p_search_path, mx::StringSet &r_dependencies) {
+	const std::string library_folder = MTLXLibrary::get_library_folder().asString();
+	for (mx::ElementPtr elem : p_doc->traverseTree()) {
+		if (elem->getActiveSourceUri().compare(0, library_folder.size(), library_folder) == 0) {
+			continue;
+		}
+		mx::NodePtr node = elem->asA<mx::Node>();
+		mx::InputPtr file = node ? node->getInput("file") : nullptr;
+		if (!file) {
+			continue;
+		}
+		mx::FilePath resolved = p_search_path.find(file->getResolvedValueString());
+		if (resolved.exists()) {
+			r_dependencies.insert(resolved.asString());
+		}
+	}
+}
+
+// Hashes everything a material is made of: its nodes and everything upstream
+// of them, with the definitions and implementations of those nodes. The files
+// they read are collected into r_dependencies: images, GLSL sources and the
+// library documents the definitions come from.
+String hash_material_definition(mx::NodePtr p_material_node, const mx::FileSearchPath &p_search_path, mx::StringSet &r_dependencies) {
+	const mx::FilePath library_root = MTLXLibrary::get_library_folder();
+	const std::string library_folder = library_root.asString();
+	std::string content;
+	std::set<mx::ElementPtr> visited;
+	std::vector<mx::ElementPtr> stack = { p_material_node };
+	while (!stack.empty()) {
+		mx::ElementPtr elem = stack.back();
+		stack.pop_back();
+		if (!elem || !visited.insert(elem).second) {
+			continue;
+		}
+		content += elem->asString();
+		content += '\n';
+		const std::string &source = elem->getActiveSourceUri();
+		if (source.compare(0, library_folder.size(), library_folder) == 0) {
+			r_dependencies.insert(source);
+		}
+		for (mx::ElementPtr child : elem->getChildren()) {
+			stack.push_back(child);
+		}
+
+		if (mx::InputPtr input = elem->asA<mx::Input>()) {
+			stack.push_back(input->getInterfaceInput());
+			stack.push_back(input->getConnectedOutput());
+			stack.push_back(input->getConnectedNode());
+			if (input->getType() == mx::FILENAME_TYPE_STRING && !input->getValueString().empty()) {
+				mx::FilePath resolved = p_search_path.find(input->getResolvedValueString());
+				if (resolved.exists()) {
+					r_dependencies.insert(resolved.asString());
+				}
+			}
+		} else if (mx::OutputPtr output = elem->asA<mx::Output>()) {
+			stack.push_back(output->getConnectedNode());
+			mx::InterfaceElementPtr graph = output->getParent()->asA<mx::InterfaceElement>();
+			if (graph && output->hasInterfaceName()) {
+				stack.push_back(graph->getInput(output->getInterfaceName()));
+			}
+		} else if (mx::NodePtr node = elem->asA<mx::Node>()) {
+			mx::NodeDefPtr node_def = node->getNodeDef();
+			if (node_def) {
+				stack.push_back(node_def);
+				stack.push_back(node_def->getImplementation(mx::GlslShaderGenerator::TARGET));
+			}
+		} else if (mx::ImplementationPtr implementation = elem->asA<mx::Implementation>()) {
+			if (implementation->hasFile()) {
+				mx::FilePath file = library_root / mx::FilePath(implementation->getFile());
+				if (file.exists()) {
+					r_dependencies.insert(file.asString());
+				}
+			}
+		}
+	}
+	return String(content.c_str()).sha256_text();
+}
+
+Ref<Material> get_previous_material(const RES &p_previous, const String &p_name) {
+	Ref<MTLXMaterialCollection> collection = p_previous;
+	if (collection.is_valid()) {
+		return collection->get_material(p_name);
+	}
+	Ref<Material> material = p_previous;
+	if (material.is_valid() && material->get_name() == p_name) {
+		return material;
+	}
+	return Ref<Material>();
+}
+
+Error load_mtlx_document(mx::DocumentPtr p_doc, String p_path, mx::GenContext context, mx::DocumentPtr p_std_lib, mx::StringSet *r_dependencies = nullptr, MTLXProfiler::Stats *p_stats = nullptr) {
 	mx::FilePath materialFilename = ProjectSettings::get_singleton()->globalize_path(p_path).utf8().get_data();
 	// 		"    --bakeWidth [INTEGER]          Specify the target width for texture baking (defaults to maximum image width of the source document)\n"
 	// 		"    --bakeHeight [INTEGER]         Specify the target height for texture baking (defaults to maximum image height of the source document)\n"
@@ -143,15 +253,9 @@ Error load_mtlx_document(mx::DocumentPtr p_doc, String p_path, mx::GenContext co
 	// Initialize search paths.
 	mx::FileSearchPath searchPath = getDefaultSearchPath(context);
 	try {
-		stdLib = mx::createDocument();
-		mx::FilePathVec libraryFolders;
-		libraryFolders.push_back(ProjectSettings::get_singleton()->globalize_path("res://libraries").utf8().get_data());
-		mx::StringSet xincludeFiles = mx::loadLibraries(libraryFolders, searchPath, stdLib);
-		// Import libraries.
-		if (xincludeFiles.empty()) {
-			std::cerr << "Could not find standard data libraries on the given "
-						 "search path: "
-					  << searchPath.asString() << std::endl;
+		// The shared library document is read-only, see MTLXLibrary.
+		stdLib = p_std_lib;
+		if (!stdLib) {
 			return FAILED;
 		}
 
@@ -195,26 +299,39 @@ Error load_mtlx_document(mx::DocumentPtr p_doc, String p_path, mx::GenContext co
 		return FAILED;
 	}
 
-	p_doc->importLibrary(stdLib);
+	{
+		// Reference the frozen library rather than copying it into every document.
+		MTLXProfiler::Scope scope(MTLXProfiler::PHASE_LIBRARY_IMPORT, p_stats);
+		p_doc->referenceLibrary(stdLib);
+	}
 
 	MaterialX::FilePath parentPath = materialFilename.getParentPath();
 	searchPath.append(materialFilename.getParentPath());
 
 	// Set up read options.
 	mx::XmlReadOptions readOptions;
-	readOptions.readXIncludeFunction = [](mx::DocumentPtr p_doc,
+	readOptions.readXIncludeFunction = [r_dependencies](mx::DocumentPtr p_doc,
 											   const mx::FilePath &materialFilename,
 											   const mx::FileSearchPath &searchPath,
 											   const mx::XmlReadOptions *newReadoptions) {
 		mx::FilePath resolvedFilename = searchPath.find(materialFilename);
 		if (resolvedFilename.exists()) {
+			if (r_dependencies) {
+				r_dependencies->insert(resolvedFilename.asString());
+			}
 			readFromXmlFile(p_doc, resolvedFilename, searchPath, newReadoptions);
 		} else {
 			std::cerr << "Include file not found: " << materialFilename.asString()
 					  << std::endl;
 		}
 	};
-	mx::readFromXmlFile(p_doc, materialFilename, searchPath, &readOptions);
+	if (r_dependencies) {
+		r_dependencies->insert(materialFilename.asString());
+	}
+	{
+		MTLXProfiler::Scope scope(MTLXProfiler::PHASE_XML_PARSE, p_stats);
+		mx::readFromXmlFile(p_doc, materialFilename, searchPath, &readOptions);
+	}
 
 	DocumentModifiers modifiers;
 	// TODO: fire 2022-03-11 Does nothing yet.
@@ -222,238 +339,999 @@ Error load_mtlx_document(mx::DocumentPtr p_doc, String p_path, mx::GenContext co
 	applyModifiers(p_doc, modifiers);
 
 	// Validate the document.
+	MTLXProfiler::Scope scope(MTLXProfiler::PHASE_VALIDATE, p_stats);
 	std::string message;
 	ERR_FAIL_COND_V_MSG(!p_doc->validate(&message), FAILED, vformat("Validation warnings for %s", String(message.c_str())));
 	return OK;
 }
 
-RES MTLXLoader::load(const String &p_path, const String &p_original_path, Error *r_error, bool p_use_sub_threads, float *r_progress, CacheMode p_cache_mode) {
-	mx::GenContext context = mx::GlslShaderGenerator::create();
-	String folder = "res://.godot/imported/" + p_path.get_file().get_basename() +
-			"-" + p_path.md5_text() + "/";
-	String mtlx = folder + p_path.get_file().get_basename() +
-			"-" + p_path.md5_text() + ".mtlx";
-	std::string bakeFilename = ProjectSettings::get_singleton()->globalize_path(mtlx).utf8().get_data();
-	mx::FileSearchPath searchPath = getDefaultSearchPath(context);
-	mx::FilePath materialFilename = ProjectSettings::get_singleton()->globalize_path(p_path).utf8().get_data();
-	searchPath.append(materialFilename.getParentPath());
-	mx::FilePathVec libraryFolders;
-	libraryFolders.push_back(ProjectSettings::get_singleton()->globalize_path("res://libraries").utf8().get_data());
-	mx::DocumentPtr stdLib;
-	stdLib = mx::createDocument();
-	mx::StringSet xincludeFiles = mx::loadLibraries(libraryFolders, searchPath, stdLib);
+// Inputs of a shader node mapped onto a texture of StandardMaterial3D.
+bool is_texture_input(const String &p_input_name) {
+	return p_input_name == "base_color" || p_input_name == "metallic" || p_input_name == "roughness" ||
+			p_input_name == "normal" || p_input_name == "emissive_color" || p_input_name == "occlusion";
+}
+
+// Inputs of a shader node that create_standard_material reads, as a texture or a value.
+bool is_mapped_input(const String &p_input_name) {
+	return is_texture_input(p_input_name) || p_input_name == "specular" || p_input_name == "emissive" ||
+			p_input_name == "alpha_mode" || p_input_name == "alpha_cutoff";
+}
+
+void apply_texture_to_material(Ref<StandardMaterial3D> p_material, const String &p_input_name, Ref<Texture2D> p_texture, int p_channel = -1) {
+	if (p_input_name == "base_color") {
+		p_material->set_flag(BaseMaterial3D::FLAG_ALBEDO_TEXTURE_FORCE_SRGB, true);
+		p_material->set_texture(BaseMaterial3D::TextureParam::TEXTURE_ALBEDO, p_texture);
+	} else if (p_input_name == "metallic") {
+		if (p_material->get_metallic() == 0.0f) {
+			p_material->set_metallic(1.0f);
+		}
+		p_material->set_metallic_texture_channel(p_channel >= 0 ? BaseMaterial3D::TextureChannel(p_channel) : BaseMaterial3D::TEXTURE_CHANNEL_BLUE);
+		p_material->set_texture(BaseMaterial3D::TEXTURE_METALLIC, p_texture);
+	} else if (p_input_name == "roughness") {
+		p_material->set_texture(BaseMaterial3D::TEXTURE_ROUGHNESS, p_texture);
+		p_material->set_roughness_texture_channel(p_channel >= 0 ? BaseMaterial3D::TextureChannel(p_channel) : BaseMaterial3D::TEXTURE_CHANNEL_GREEN);
+	} else if (p_input_name == "normal") {
+		p_material->set_feature(StandardMaterial3D::FEATURE_NORMAL_MAPPING, true);
+		p_material->set_texture(StandardMaterial3D::TEXTURE_NORMAL, p_texture);
+	} else if (p_input_name == "emissive_color") {
+		p_material->set_feature(BaseMaterial3D::FEATURE_EMISSION, true);
+		p_material->set_texture(BaseMaterial3D::TEXTURE_EMISSION, p_texture);
+	} else if (p_input_name == "occlusion") {
+		p_material->set_texture(BaseMaterial3D::TEXTURE_AMBIENT_OCCLUSION, p_texture);
+		p_material->set_ao_texture_channel(p_channel >= 0 ? BaseMaterial3D::TextureChannel(p_channel) : BaseMaterial3D::TEXTURE_CHANNEL_RED);
+	}
+}
+
+Image::CompressSource get_compress_source(const String &p_input_name) {
+	if (p_input_name == "base_color" || p_input_name == "emissive_color") {
+		return Image::COMPRESS_SOURCE_SRGB;
+	}
+	return Image::COMPRESS_SOURCE_GENERIC;
+}
+
+// Return the variant an image job decodes its image to. Generated shaders read
+// images that aren't VRAM-compressed, and color images are compressed
+// differently from data images, so each of these is a distinct texture.
+String get_texture_variant(const MTLXTextureJob &p_job) {
+	if (!p_job.store_compressed) {
+		return "uncompressed";
+	}
+	return get_compress_source(p_job.input_name) == Image::COMPRESS_SOURCE_SRGB ? "srgb" : "";
+}
+
+Error compress_image(Ref<Image> p_image, Image::CompressSource p_source) {
+	bool hdr = p_image->get_format() >= Image::FORMAT_RF && p_image->get_format() <= Image::FORMAT_RGBE9995;
+	if (GLOBAL_GET("rendering/textures/vram_compression/import_s3tc")) {
+		return p_image->compress(hdr ? Image::COMPRESS_BPTC : Image::COMPRESS_S3TC, p_source);
+	}
+	if (GLOBAL_GET("rendering/textures/vram_compression/import_etc2")) {
+		return p_image->compress(Image::COMPRESS_ETC2, p_source);
+	}
+	return ERR_UNAVAILABLE;
+}
+
+// Save a resource under a temporary name and rename it into place, so that
+// other loaders and bake workers sharing the folder never read it half written.
+Error save_resource_atomic(const String &p_path, const RES &p_resource) {
+	String temporary_path = vformat("%s.tmp%d_%d.%s", p_path.get_basename(), OS::get_singleton()->get_process_id(), (uint64_t)Thread::get_caller_id(), p_path.get_extension());
+	Error err = ResourceSaver::save(temporary_path, p_resource);
+	DirAccessRef d = DirAccess::create_for_path(p_path);
+	if (err == OK) {
+		err = d->rename(temporary_path, p_path);
+	}
+	if (err != OK) {
+		d->remove(temporary_path);
+	}
+	return err;
+}
+
+// Merge the baked occlusion, roughness and metallic images into a single RGB
+// image laid out the way StandardMaterial3D samples them (R, G and B), and point
+// all of those jobs at it. Only jobs of the given material are considered.
+Error pack_orm_textures(Vector<MTLXTextureJob> &r_jobs, int p_material_index, const String &p_packed_path, MTLXProfiler::Stats *p_stats) {
+	static const char *orm_inputs[3] = { "occlusion", "roughness", "metallic" };
+	int job_indices[3] = { -1, -1, -1 };
+	int used = 0;
+	for (int i = 0; i < r_jobs.size(); i++) {
+		for (int channel = 0; channel < 3; channel++) {
+			if (r_jobs[i].material_index == p_material_index && r_jobs[i].input_name == orm_inputs[channel] && job_indices[channel] == -1) {
+				job_indices[channel] = i;
+				used++;
+			}
+		}
+	}
+	if (used < 2) {
+		return ERR_SKIP;
+	}
+
+	uint64_t packed_time = FileAccess::exists(p_packed_path) ? FileAccess::get_modified_time(p_packed_path) : 0;
+	bool up_to_date = packed_time > 0;
+	Vector<String> paths;
+	for (int channel = 0; channel < 3; channel++) {
+		if (job_indices[channel] == -1) {
+			continue;
+		}
+		const String &path = r_jobs[job_indices[channel]].path;
+		if (!paths.has(path)) {
+			paths.push_back(path);
+		}
+		if (FileAccess::get_modified_time(path) > packed_time) {
+			up_to_date = false;
+		}
+	}
+	if (paths.size() < 2) {
+		// Already packed by the source document.
+		return ERR_SKIP;
+	}
+
+	if (!up_to_date) {
+		Ref<Image> sources[3];
+		int source_channels[3] = { 0, 1, 2 };
+		int width = 0;
+		int height = 0;
+		for (int channel = 0; channel < 3; channel++) {
+			if (job_indices[channel] == -1) {
+				continue;
+			}
+			const String &path = r_jobs[job_indices[channel]].path;
+			if (r_jobs[job_indices[channel]].channel >= 0) {
+				source_channels[channel] = r_jobs[job_indices[channel]].channel;
+			}
+			sources[channel].instantiate();
+			MTLXProfiler::Scope scope(MTLXProfiler::PHASE_TEXTURE_DECODE, p_stats);
+			Error err = ImageLoader::load_image(path, sources[channel]);
+			ERR_FAIL_COND_V_MSG(err != OK, err, vformat("Can't load MaterialX image %s for packing", path));
+			if (sources[channel]->is_compressed()) {
+				sources[channel]->decompress();
+			}
+			sources[channel]->convert(Image::FORMAT_RGBA8);
+			width = MAX(width, sources[channel]->get_width());
+			height = MAX(height, sources[channel]->get_height());
+		}
+		for (int channel = 0; channel < 3; channel++) {
+			if (sources[channel].is_valid() && (sources[channel]->get_width() != width || sources[channel]->get_height() != height)) {
+				sources[channel]->resize(width, height);
+			}
+		}
+
+		Ref<Image> packed;
+		packed.instantiate();
+		packed->create(width, height, false, Image::FORMAT_RGB8);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				// Unused channels stay white, which is neutral for occlusion.
+				Color color(1, 1, 1);
+				for (int channel = 0; channel < 3; channel++) {
+					if (sources[channel].is_valid()) {
+						color.components[channel] = sources[channel]->get_pixel(x, y).components[source_channels[channel]];
+					}
+				}
+				packed->set_pixel(x, y, color);
+			}
+		}
+		MTLXProfiler::Scope scope(MTLXProfiler::PHASE_IMAGE_WRITE, p_stats);
+		Error err = packed->save_png(p_packed_path);
+		ERR_FAIL_COND_V_MSG(err != OK, err, vformat("Can't write packed MaterialX image %s", p_packed_path));
+	}
+
+	for (int channel = 0; channel < 3; channel++) {
+		if (job_indices[channel] != -1) {
+			MTLXTextureJob &job = r_jobs.write[job_indices[channel]];
+			job.path = p_packed_path;
+			job.compressed_folder = String();
+			job.channel = -1;
+		}
+	}
+	print_verbose(vformat("MaterialX packed %d baked inputs into %s", used, p_packed_path));
+	return OK;
+}
+
+void MTLXLoader::_decode_texture_job(uint32_t p_index, MTLXTextureJob *p_jobs) {
+	MTLXTextureJob &job = p_jobs[p_index];
+
+	// Baked images are mipmapped and VRAM-compressed once, and the result is
+	// stored next to them in the import folder.
+	String source_path = job.path.is_absolute_path() ? job.path : "res://" + job.path;
+	// The compression source is part of the name, as an image may be both a
+	// color and a data input.
+	Image::CompressSource compress_source = get_compress_source(job.input_name);
+	String compressed_extension = compress_source == Image::COMPRESS_SOURCE_SRGB ? ".srgb.image.res" : ".image.res";
+	String compressed_path = source_path.get_basename() + compressed_extension;
+	if (!job.compressed_folder.is_empty()) {
+		compressed_path = job.compressed_folder.plus_file(source_path.get_file().get_basename() + "-" + source_path.md5_text() + compressed_extension);
+	}
+	String preview_path = MTLXTextureStreamer::get_preview_path(compressed_path);
+	uint64_t source_time = FileAccess::get_modified_time(source_path);
+	job.texture_path = String(MTLX_BAKED_IMAGE_FOLDER).plus_file(source_path.get_file().get_basename() + "-" + MTLXTextureCache::get_key(source_path, get_texture_variant(job)).md5_text() + ".texture.res");
+	if (job.store_compressed && FileAccess::exists(compressed_path) &&
+			FileAccess::get_modified_time(compressed_path) >= source_time) {
+		MTLXProfiler::Scope scope(MTLXProfiler::PHASE_TEXTURE_DECODE, job.stats);
+		if (job.stream && FileAccess::exists(preview_path) && FileAccess::get_modified_time(preview_path) >= source_time) {
+			job.image = ResourceLoader::load(preview_path, "Image", ResourceFormatLoader::CACHE_MODE_IGNORE);
+			if (job.image.is_valid()) {
+				MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_COMPRESSED_IMAGE, true, job.stats);
+				job.stream_path = compressed_path;
+				// The stored image holds its data as is, so its length bounds the
+				// size of the full image without reading it.
+				FileAccessRef f = FileAccess::open(compressed_path, FileAccess::READ);
+				job.stream_size = f ? f->get_length() : 0;
+				job.error = OK;
+				return;
+			}
+		}
+		job.image = ResourceLoader::load(compressed_path, "Image", ResourceFormatLoader::CACHE_MODE_IGNORE);
+		if (job.image.is_valid()) {
+			MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_COMPRESSED_IMAGE, true, job.stats);
+			job.error = OK;
+			return;
+		}
+	}
+	if (job.store_compressed) {
+		MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_COMPRESSED_IMAGE, false, job.stats);
+	}
+
+	job.image.instantiate();
 	{
-		// Load source document.
-		mx::DocumentPtr doc = mx::createDocument();
-		Error err;
-		try {
-			err = load_mtlx_document(doc, p_path, context);
-		} catch (std::exception &e) {
-			ERR_PRINT("Can't load materials.");
-			return RES();
+		MTLXProfiler::Scope scope(MTLXProfiler::PHASE_TEXTURE_DECODE, job.stats);
+		job.error = ImageLoader::load_image(job.path, job.image);
+	}
+	if (job.error != OK) {
+		return;
+	}
+	{
+		MTLXProfiler::Scope scope(MTLXProfiler::PHASE_MIPMAP, job.stats);
+		job.image->generate_mipmaps();
+	}
+	if (!job.store_compressed) {
+		return;
+	}
+	{
+		MTLXProfiler::Scope scope(MTLXProfiler::PHASE_COMPRESS, job.stats);
+		if (compress_image(job.image, compress_source) != OK) {
+			print_verbose(vformat("MaterialX texture %s is stored uncompressed", job.path));
 		}
+	}
+	MTLXProfiler::Scope scope(MTLXProfiler::PHASE_IMAGE_WRITE, job.stats);
+	save_resource_atomic(compressed_path, job.image);
+	Ref<Image> preview = MTLXTextureStreamer::create_preview(job.image);
+	if (preview.is_valid()) {
+		save_resource_atomic(preview_path, preview);
+	}
+}
 
-		if (err != OK) {
-			return RES();
+void MTLXLoader::finish() {
+	MutexLock lock(decode_pool_mutex);
+	if (decode_pool_started) {
+		decode_pool.finish();
+		decode_pool_started = false;
+	}
+}
+
+void MTLXLoader::_load_texture_jobs(Vector<MTLXTextureJob> &r_jobs, bool p_use_sub_threads, MTLXProfiler::Stats *p_stats) {
+	// Decode each file at most once per variant, and only when the shared cache
+	// doesn't already hold it.
+	HashMap<String, Ref<Texture2D>> textures;
+	Vector<MTLXTextureJob> decode_jobs;
+	bool stream = texture_streaming && MTLXTextureStreamer::is_enabled();
+	for (int i = 0; i < r_jobs.size(); i++) {
+		const String &path = r_jobs[i].path;
+		String variant = get_texture_variant(r_jobs[i]);
+		String key = MTLXTextureCache::get_key(path, variant);
+		if (textures.has(key)) {
+			continue;
+		}
+		Ref<Texture2D> texture = MTLXTextureCache::get(path, variant);
+		MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_TEXTURE, texture.is_valid(), p_stats);
+		textures[key] = texture;
+		if (texture.is_null()) {
+			decode_jobs.push_back(r_jobs[i]);
+			decode_jobs.write[decode_jobs.size() - 1].stats = p_stats;
+			decode_jobs.write[decode_jobs.size() - 1].stream = stream;
 		}
-		int bakeWidth = -1;
-		int bakeHeight = -1;
-		std::string bakeFormat;
-		bool bakeHdr = false;
-		imageHandler->setSearchPath(searchPath);
+	}
 
-		if (bakeFormat == std::string("EXR") || bakeFormat == std::string("exr")) {
-			bakeHdr = true;
-#if MATERIALX_BUILD_OIIO
-			imageHandler->addLoader(mx::OiioImageLoader::create());
-#else
-			ERR_PRINT(vformat("OpenEXR is not supported"));
-			return RES();
-#endif
+	if (!p_use_sub_threads || decode_jobs.size() < 2) {
+		for (int i = 0; i < decode_jobs.size(); i++) {
+			_decode_texture_job(i, decode_jobs.ptrw());
+		}
+	} else {
+		MutexLock lock(decode_pool_mutex);
+		if (!decode_pool_started) {
+			decode_pool.init();
+			decode_pool_started = true;
+		}
+		decode_pool.do_work(decode_jobs.size(), this, &MTLXLoader::_decode_texture_job, decode_jobs.ptrw());
+	}
+
+	for (int i = 0; i < decode_jobs.size(); i++) {
+		const MTLXTextureJob &job = decode_jobs[i];
+		String variant = get_texture_variant(job);
+		Ref<ImageTexture> tex;
+		tex.instantiate();
+		if (job.error == OK) {
+			tex->create_from_image(job.image);
+			// Streamed textures are accounted for at their full size.
+			MTLXTextureCache::add(job.path, variant, tex, job.stream_path.is_empty() ? job.image->get_data().size() : job.stream_size);
+			if (!job.stream_path.is_empty()) {
+				MTLXTextureStreamer::request(tex, job.stream_path, job.image);
+			}
+			// Materials saved in the import cache then reference the texture
+			// instead of embedding a copy, and every cached import shares it.
+			String source_path = job.path.is_absolute_path() ? job.path : "res://" + job.path;
+			if (!FileAccess::exists(job.texture_path) || FileAccess::get_modified_time(job.texture_path) < FileAccess::get_modified_time(source_path)) {
+				MTLXProfiler::Scope scope(MTLXProfiler::PHASE_IMAGE_WRITE, p_stats);
+				DirAccessRef d = DirAccess::create(DirAccess::ACCESS_RESOURCES);
+				d->make_dir_recursive(job.texture_path.get_base_dir());
+				save_resource_atomic(job.texture_path, tex);
+			}
+			if (FileAccess::exists(job.texture_path)) {
+				tex->set_path(job.texture_path, true);
+			}
+		}
+		textures[MTLXTextureCache::get_key(job.path, variant)] = tex;
+	}
+	for (int i = 0; i < r_jobs.size(); i++) {
+		r_jobs.write[i].texture = textures[MTLXTextureCache::get_key(r_jobs[i].path, get_texture_variant(r_jobs[i]))];
+	}
+}
+
+// Return the input holding the value of a node input, following an interface
+// name to the input of the enclosing node graph.
+mx::InputPtr get_value_source(const mx::InputPtr &p_input) {
+	mx::InputPtr interface_input = p_input->getInterfaceInput();
+	return interface_input ? interface_input : p_input;
+}
+
+// Translate a material to a ShaderMaterial running the MaterialX graph itself,
+// queueing the images bound to its sampler uniforms. Materials whose graphs
+// share a topology share the shader, and set its uniforms from their inputs.
+Ref<ShaderMaterial> create_shader_material(const mx::NodePtr &p_material_node, int p_material_index, mx::GenContext &p_context, const mx::FileSearchPath &p_search_path, Vector<MTLXTextureJob> &r_texture_jobs, MTLXProfiler::Stats *p_stats) {
+	std::vector<mx::NodePtr> shader_nodes = mx::getShaderNodes(p_material_node, mx::SURFACE_SHADER_TYPE_STRING);
+	if (shader_nodes.empty()) {
+		return Ref<ShaderMaterial>();
+	}
+	std::vector<mx::InputPtr> inputs;
+	String topology = MTLXShaderCache::hash_topology(shader_nodes[0], inputs);
+	MTLXShaderCache::Entry entry;
+	bool cached = MTLXShaderCache::get(topology, entry);
+	MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_SHADER, cached, p_stats);
+	if (!cached) {
+		mx::ShaderPtr shader;
+		{
+			MTLXProfiler::Scope scope(MTLXProfiler::PHASE_SHADER_GENERATE, p_stats);
+			shader = p_context.getShaderGenerator().generate(p_material_node->getName(), shader_nodes[0], p_context);
 		}
-		// Compute baking resolution.
-		mx::ImageVec imageVec = imageHandler->getReferencedImages(doc);
-		auto maxImageSize = mx::getMaxDimensions(imageVec);
-		if (bakeWidth == -1) {
-			bakeWidth = std::max(maxImageSize.first, (unsigned int)4);
+		ERR_FAIL_COND_V(!shader, Ref<ShaderMaterial>());
+		String code = MTLXGodotShaderGenerator::get_source_code(shader).c_str();
+		// Code Godot can't compile falls back to baking, instead of rendering nothing.
+		String error = MTLXGodotShaderGenerator::validate_source_code(code);
+		if (!error.is_empty()) {
+			print_verbose(vformat("MaterialX shader generated for %s doesn't compile, %s", String(p_material_node->getName().c_str()), error));
+			return Ref<ShaderMaterial>();
 		}
-		if (bakeHeight == -1) {
-			bakeHeight = std::max(maxImageSize.second, (unsigned int)4);
+		entry = MTLXShaderCache::add(topology, shader, code, inputs);
+	}
+
+	Ref<ShaderMaterial> mat;
+	mat.instantiate();
+	mat->set_name(String(p_material_node->getName().c_str()));
+	mat->set_shader(entry.shader);
+
+	for (int i = 0; i < entry.uniforms.size(); i++) {
+		const MTLXShaderCache::Uniform &uniform = entry.uniforms[i];
+		mx::InputPtr input = get_value_source(inputs[uniform.input_index]);
+		if (!input->hasValue()) {
+			continue;
+		}
+		if (uniform.type != mx::FILENAME_TYPE_STRING) {
+			Variant value = get_value_as_material_x_variant(input);
+			if (value.get_type() == Variant::COLOR && (uniform.type == "color3" || uniform.type == "vector3")) {
+				Color color = value;
+				value = Vector3(color.r, color.g, color.b);
+			}
+			if (value.get_type() != Variant::NIL) {
+				mat->set_shader_param(uniform.variable, value);
+			}
+			continue;
 		}
+		mx::FilePath resolved = p_search_path.find(input->getResolvedValueString());
+		if (!resolved.exists()) {
+			WARN_PRINT(vformat("MaterialX image %s not found", String(input->getResolvedValueString().c_str())));
+			continue;
+		}
+		MTLXTextureJob job;
+		job.material_index = p_material_index;
+		job.input_name = uniform.variable;
+		job.path = ProjectSettings::get_singleton()->localize_path(String(resolved.asString().c_str()).replace("\\", "/"));
+		job.store_compressed = false;
+		r_texture_jobs.push_back(job);
+	}
+	return mat;
+}
+
+bool is_input_connected(const mx::InputPtr &p_input) {
+	mx::InputPtr source = get_value_source(p_input);
+	return source->hasNodeName() || source->hasNodeGraphString();
+}
+
+// Return the image node read by a shader input, looking through a normalmap
+// node, or null when the input isn't connected to an image.
+mx::NodePtr get_image_node(const mx::InputPtr &p_input) {
+	mx::NodePtr node = p_input->getConnectedNode();
+	if (node && node->getCategory() == "normalmap") {
+		mx::InputPtr in = node->getInput("in");
+		node = in ? in->getConnectedNode() : nullptr;
+	}
+	return node && node->getCategory() == "image" ? node : nullptr;
+}
 
-		// Construct a texture baker.
-		mx::Image::BaseType baseType =
-				bakeHdr ? mx::Image::BaseType::FLOAT : mx::Image::BaseType::UINT8;
-		mx::TextureBakerPtr baker =
-				mx::TextureBaker::create(bakeWidth, bakeHeight, baseType);
-		baker->setupUnitSystem(stdLib);
-		baker->setDistanceUnit(context.getOptions().targetDistanceUnit);
-		bool bakeAverage = false;
-		bool bakeOptimize = true;
-		baker->setAverageImages(bakeAverage);
-		baker->setOptimizeConstants(bakeOptimize);
+// Whether a shader input reads an image file as is, so that the file can be
+// assigned to StandardMaterial3D instead of being baked. Normals must read a
+// tangent space normal map through an unscaled normalmap node.
+bool is_direct_image_lookup(const mx::InputPtr &p_input, bool p_normal) {
+	mx::NodePtr node = p_input->getConnectedNode();
+	if (!node) {
+		return false;
+	}
+	if (p_normal) {
+		if (node->getCategory() != "normalmap") {
+			return false;
+		}
+		for (mx::InputPtr input : node->getInputs()) {
+			const std::string &name = input->getName();
+			mx::InputPtr source = get_value_source(input);
+			if (name == "in") {
+				continue;
+			}
+			if (is_input_connected(input) || !source->getValue()) {
+				return false;
+			}
+			mx::ValuePtr value = source->getValue();
+			if (name == "space") {
+				if (value->getValueString() != "tangent") {
+					return false;
+				}
+			} else if (name == "scale") {
+				if (!(value->isA<float>() && value->asA<float>() == 1.0f) && !(value->isA<mx::Vector2>() && value->asA<mx::Vector2>() == mx::Vector2(1.0f))) {
+					return false;
+				}
+			} else {
+				return false;
+			}
+		}
+		mx::InputPtr in = node->getInput("in");
+		node = in ? in->getConnectedNode() : nullptr;
+		if (!node) {
+			return false;
+		}
+	}
+	if (node->getCategory() != "image") {
+		return false;
+	}
+	for (mx::InputPtr input : node->getInputs()) {
+		const std::string &name = input->getName();
+		mx::InputPtr source = get_value_source(input);
+		if (name == "file") {
+			if (is_input_connected(input) || source->getResolvedValueString().empty()) {
+				return false;
+			}
+			// StandardMaterial3D decodes color textures from sRGB.
+			if ((node->getType() == "color3" || node->getType() == "color4") && source->getActiveColorSpace() != "srgb_texture") {
+				return false;
+			}
+		} else if (name == "texcoord") {
+			if (!is_input_connected(input)) {
+				if (source->hasValueString()) {
+					return false;
+				}
+				continue;
+			}
+			mx::NodePtr texcoord = input->getConnectedNode();
+			if (!texcoord || texcoord->getCategory() != "texcoord") {
+				return false;
+			}
+			mx::InputPtr index = texcoord->getInput("index");
+			if (index && (is_input_connected(index) || get_value_source(index)->getValueString() != "0")) {
+				return false;
+			}
+		} else if (name == "uaddressmode" || name == "vaddressmode") {
+			if (is_input_connected(input) || (source->hasValueString() && source->getValueString() != "periodic")) {
+				return false;
+			}
+		} else if (name == "filtertype" || name == "layer" || name == "default") {
+			if (is_input_connected(input)) {
+				return false;
+			}
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
 
-		DirAccessRef d = DirAccess::create(DirAccess::ACCESS_RESOURCES);
-		d->make_dir_recursive(folder);
+// Whether a material maps onto StandardMaterial3D without baking: every input
+// the mapping reads is a value or a direct image lookup.
+bool is_direct_material(const mx::NodePtr &p_material_node) {
+	std::vector<mx::NodePtr> shader_nodes = mx::getShaderNodes(p_material_node);
+	if (shader_nodes.empty()) {
+		return false;
+	}
+	for (mx::NodePtr shader_node : shader_nodes) {
+		for (mx::InputPtr input : shader_node->getInputs()) {
+			String input_name = input->getName().c_str();
+			if (!is_input_connected(input) || !is_mapped_input(input_name)) {
+				continue;
+			}
+			if (!is_texture_input(input_name) || !is_direct_image_lookup(input, input_name == "normal")) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
 
-		// Bake all materials in the active document.
-		try {
-			baker->bakeAllMaterials(doc, searchPath, bakeFilename);
-		} catch (std::exception &e) {
-			ERR_PRINT("Can't bake materials.");
+// Map a baked material, or one passing is_direct_material, onto StandardMaterial3D.
+// Source images outside the import folder have their compressed copies stored there.
+Ref<StandardMaterial3D> create_standard_material(const mx::NodePtr &p_material_node, int p_material_index, const mx::FileSearchPath &p_search_path, const String &p_import_folder, Vector<MTLXTextureJob> &r_texture_jobs) {
+	Ref<StandardMaterial3D> mat;
+	mat.instantiate();
+	// The baker appends "_baked" to every material it writes.
+	mat->set_name(String(p_material_node->getName().c_str()).trim_suffix("_baked"));
+	for (mx::NodePtr node_inputs : mx::getShaderNodes(p_material_node)) {
+		const std::string &node_name = node_inputs->getName();
+		print_verbose(vformat("MaterialX material name %s", String(node_name.c_str())));
+		const std::string &category_name = node_inputs->getCategory();
+		print_verbose(vformat("MaterialX material type %s", String(category_name.c_str())));
+		for (mx::InputPtr input : node_inputs->getInputs()) {
+			const std::string &input_name = input->getName();
+			print_verbose(vformat("MaterialX input %s", String(input_name.c_str())));
+			if (is_input_connected(input)) {
+				mx::NodePtr image_node = get_image_node(input);
+				mx::InputPtr file = image_node ? image_node->getInput("file") : nullptr;
+				if (!file || !is_texture_input(input_name.c_str())) {
+					continue;
+				}
+				mx::FilePath resolved = p_search_path.find(get_value_source(file)->getResolvedValueString());
+				if (!resolved.exists()) {
+					WARN_PRINT(vformat("MaterialX image %s not found", String(resolved.asString().c_str())));
+					continue;
+				}
+				String filepath = ProjectSettings::get_singleton()->localize_path(String(resolved.asString().c_str()).replace("\\", "/"));
+				print_verbose(vformat("MaterialX attribute name %s", String(input->getOutputString().c_str())));
+				print_verbose(vformat("MaterialX attribute filepath %s", filepath));
+				MTLXTextureJob job;
+				job.material_index = p_material_index;
+				job.input_name = input_name.c_str();
+				job.path = filepath;
+				if (!filepath.begins_with(p_import_folder) && !filepath.begins_with(MTLX_BAKED_IMAGE_FOLDER)) {
+					job.compressed_folder = p_import_folder;
+				}
+				if (input->getType() == "float") {
+					// Float image lookups read the red channel.
+					job.channel = BaseMaterial3D::TEXTURE_CHANNEL_RED;
+				}
+				r_texture_jobs.push_back(job);
+				continue;
+			}
+			Variant v = get_value_as_material_x_variant(get_value_source(input));
+			// <input name="transmission" type="float" value="0" />
+			// <input name="specular_color" type="color3" value="1, 1, 1" />
+			// <input name="ior" type="float" value="1.5" />
+			// <input name="alpha" type="float" value="1" />
+			// <input name="sheen_color" type="color3" value="0, 0, 0" />
+			// <input name="sheen_roughness" type="float" value="0" />
+			// <input name="clearcoat" type="float" value="0" />
+			// <input name="clearcoat_roughness" type="float" value="0" />
+			// <input name="clearcoat_normal" type="vector3" value="0, 0, 1" />
+			// <input name="emissive" type="color3" value="0, 0, 0" />
+			// <input name="thickness" type="float" value="0" />
+			// <input name="attenuation_distance" type="float" value="100000" />
+			// <input name="attenuation_color" type="color3" value="0, 0, 0" />
+			if (input_name == "base_color") {
+				Color c = mat->get_albedo();
+				Color variant_color = v;
+				c.r = variant_color.r;
+				c.g = variant_color.g;
+				c.b = variant_color.b;
+				c.a = variant_color.a;
+				mat->set_albedo(c);
+			} else if (input_name == "metallic") {
+				mat->set_metallic(v);
+			} else if (input_name == "roughness") {
+				mat->set_roughness(v);
+			} else if (input_name == "specular") {
+				mat->set_specular(v);
+			} else if (input_name == "normal") {
+				mat->set_feature(StandardMaterial3D::FEATURE_NORMAL_MAPPING, true);
+			} else if (input_name == "emissive") {
+				mat->set_feature(BaseMaterial3D::FEATURE_EMISSION, true);
+				mat->set_emission(v);
+			} else if (input_name == "alpha_mode") {
+				if (v) {
+					mat->set_transparency(BaseMaterial3D::TRANSPARENCY_ALPHA);
+					mat->set_alpha_antialiasing(BaseMaterial3D::ALPHA_ANTIALIASING_ALPHA_TO_COVERAGE_AND_TO_ONE);
+					mat->set_depth_draw_mode(BaseMaterial3D::DEPTH_DRAW_ALWAYS);
+				}
+			} else if (input_name == "alpha_cutoff") {
+				mat->set_transparency(BaseMaterial3D::TRANSPARENCY_ALPHA_SCISSOR);
+				mat->set_depth_draw_mode(BaseMaterial3D::DEPTH_DRAW_ALWAYS);
+				mat->set_alpha_scissor_threshold(v);
+			} else if (input_name == "base_color") {
+				Color c = mat->get_albedo();
+				c.a = c.a * Color(v).a;
+				mat->set_albedo(c);
+			}
+			print_verbose(vformat("MaterialX attribute value %s", v));
 		}
+	}
+	return mat;
+}
+
+String MTLXBakeSettings::to_string() const {
+	return vformat("%d,%d,%s,%s,%s,%s", width, height, String(format.c_str()), average, optimize, cpu);
+}
+
+MTLXBakeSettings MTLXBakeSettings::from_string(const String &p_string) {
+	MTLXBakeSettings settings;
+	Vector<String> fields = p_string.split(",");
+	ERR_FAIL_COND_V(fields.size() != 6, settings);
+	settings.width = fields[0].to_int();
+	settings.height = fields[1].to_int();
+	settings.format = fields[2].utf8().get_data();
+	settings.average = fields[3] == "true";
+	settings.optimize = fields[4] == "true";
+	settings.cpu = fields[5] == "true";
+	return settings;
+}
+
+// Load a document along with the data libraries, and the search path resolving
+// the files it references.
+Error MTLXLoader::_open_document(const String &p_path, mx::GenContext &p_context, mx::FileSearchPath &r_search_path, mx::DocumentPtr &r_std_lib, mx::DocumentPtr &r_doc, mx::StringSet *r_dependencies, MTLXProfiler::Stats *p_stats) {
+	r_search_path = getDefaultSearchPath(p_context);
+	mx::FilePath materialFilename = ProjectSettings::get_singleton()->globalize_path(p_path).utf8().get_data();
+	r_search_path.append(materialFilename.getParentPath());
+	try {
+		r_std_lib = MTLXLibrary::get(r_search_path, p_stats);
+	} catch (std::exception &e) {
+		ERR_PRINT(vformat("Failed to load standard data libraries: %s", String(e.what())));
+	}
+	if (!r_std_lib) {
+		return ERR_CANT_OPEN;
+	}
 
-		// Release any render resources generated by the baking process.
-		imageHandler->releaseRenderResources();
+	// Load source document.
+	r_doc = mx::createDocument();
+	try {
+		return load_mtlx_document(r_doc, p_path, p_context, r_std_lib, r_dependencies, p_stats);
+	} catch (std::exception &e) {
+		ERR_PRINT(vformat("Can't load materials: %s", String(e.what())));
 	}
-	mx::DocumentPtr new_doc = mx::createDocument();
-	Error err;
+	return ERR_PARSE_ERROR;
+}
+
+Error MTLXLoader::_bake_materials(mx::DocumentPtr p_doc, mx::DocumentPtr p_std_lib, const mx::GenContext &p_context, const mx::FileSearchPath &p_search_path, const String &p_folder, const std::vector<mx::TypedElementPtr> &p_materials, MTLXBakeSettings p_settings, mx::BakedDocumentVec &r_documents, MTLXProfiler::Stats *p_stats) {
+	bool bakeHdr = false;
+	imageHandler->setSearchPath(p_search_path);
+
+	if (p_settings.format == std::string("EXR") || p_settings.format == std::string("exr")) {
+		bakeHdr = true;
+#if MATERIALX_BUILD_OIIO
+		imageHandler->addLoader(mx::OiioImageLoader::create());
+#else
+		ERR_PRINT(vformat("OpenEXR is not supported"));
+		return ERR_UNAVAILABLE;
+#endif
+	}
+	// Compute baking resolution.
+	mx::ImageVec imageVec = imageHandler->getReferencedImages(p_doc);
+	auto maxImageSize = mx::getMaxDimensions(imageVec);
+	if (p_settings.width == -1) {
+		p_settings.width = std::max(maxImageSize.first, (unsigned int)4);
+	}
+	if (p_settings.height == -1) {
+		p_settings.height = std::max(maxImageSize.second, (unsigned int)4);
+	}
+
+	// Construct a texture baker.
+	mx::Image::BaseType baseType =
+			bakeHdr ? mx::Image::BaseType::FLOAT : mx::Image::BaseType::UINT8;
+	mx::TextureBakerPtr baker;
+	if (p_settings.cpu) {
+		baker = mx::CpuTextureBaker::create(p_settings.width, p_settings.height, baseType);
+	} else {
+		baker = mx::TextureBaker::create(p_settings.width, p_settings.height, baseType);
+	}
+	baker->setupUnitSystem(p_std_lib);
+	baker->setDistanceUnit(p_context.getOptions().targetDistanceUnit);
+	baker->setAverageImages(p_settings.average);
+	baker->setOptimizeConstants(p_settings.optimize);
+
+	baker->setOutputImagePath(ProjectSettings::get_singleton()->globalize_path(p_folder).utf8().get_data());
+	// Identical images baked for any material of the project are stored, compressed
+	// and loaded once.
+	baker->setContentImagePath(ProjectSettings::get_singleton()->globalize_path(MTLX_BAKED_IMAGE_FOLDER).utf8().get_data());
+	// Outputs baked before, by any material of the project, aren't rendered again.
+	baker->setBakeCache(ProjectSettings::get_singleton()->globalize_path(MTLX_BAKE_CACHE_FOLDER).utf8().get_data(), std::to_string(MTLXLibrary::get_fingerprint()));
+
+	// Only the images go to disk; the baked documents are used directly.
+	Error err = OK;
 	try {
-		err = load_mtlx_document(new_doc, bakeFilename.c_str(), mx::GlslShaderGenerator::create());
+		r_documents = baker->bakeMaterialsToDocs(p_doc, p_search_path, p_materials);
 	} catch (std::exception &e) {
-		ERR_PRINT("Can't load materials.");
-		return RES();
+		ERR_PRINT(vformat("Can't bake materials: %s", String(e.what())));
+		err = ERR_CANT_CREATE;
+	}
+	// The baker skips the materials it fails to bake.
+	if (err == OK && r_documents.size() < p_materials.size()) {
+		ERR_PRINT(vformat("Can't bake %d of %d materials", int(p_materials.size() - r_documents.size()), (int)p_materials.size()));
+		err = ERR_CANT_CREATE;
+	}
+	const mx::TextureBaker::BakeStatistics &bake_stats = baker->getStatistics();
+	MTLXProfiler::add_time(MTLXProfiler::PHASE_SHADER_GENERATE, bake_stats.generationTime, p_stats, bake_stats.generationCount);
+	MTLXProfiler::add_time(MTLXProfiler::PHASE_BAKE_RENDER, bake_stats.renderTime, p_stats, bake_stats.renderCount);
+	MTLXProfiler::add_time(MTLXProfiler::PHASE_IMAGE_WRITE, bake_stats.imageWriteTime, p_stats, bake_stats.imageWriteCount);
+	for (unsigned int i = 0; i < bake_stats.cacheHitCount + bake_stats.cacheMissCount; i++) {
+		MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_BAKE, i < bake_stats.cacheHitCount, p_stats);
 	}
 
-	xincludeFiles = mx::loadLibraries(libraryFolders, searchPath, stdLib);
+	// Release any render resources generated by the baking process.
+	imageHandler->releaseRenderResources();
+	return err;
+}
+
+Error MTLXLoader::bake_materials(const String &p_path, const Vector<String> &p_names, const MTLXBakeSettings &p_settings, mx::BakedDocumentVec &r_documents) {
+	mx::GenContext context = mx::GlslShaderGenerator::create();
+	mx::FileSearchPath search_path;
+	mx::DocumentPtr std_lib;
+	mx::DocumentPtr doc;
+	Error err = _open_document(p_path, context, search_path, std_lib, doc, nullptr, nullptr);
 	if (err != OK) {
-		return RES();
+		return err;
 	}
 	std::vector<mx::TypedElementPtr> renderable_materials;
-	findRenderableElements(new_doc, renderable_materials);
-	Ref<StandardMaterial3D> mat;
-	mat.instantiate();
-	for (size_t i = 0; i < renderable_materials.size(); i++) {
-		const mx::TypedElementPtr &element = renderable_materials[i];
-		if (!element || !element->isA<mx::Node>()) {
-			continue;
+	std::vector<mx::TypedElementPtr> bake_materials;
+	findRenderableElements(doc, renderable_materials);
+	for (const mx::TypedElementPtr &element : renderable_materials) {
+		if (element && element->isA<mx::Node>() && p_names.has(String(element->getName().c_str()))) {
+			bake_materials.push_back(element);
 		}
-		const mx::NodePtr &node = element->asA<mx::Node>();
-		for (mx::NodePtr node_inputs : mx::getShaderNodes(node)) {
-			const std::string &node_name = node_inputs->getName();
-			print_verbose(vformat("MaterialX material name %s", String(node_name.c_str())));
-			const std::string &category_name = node_inputs->getCategory();
-			print_verbose(vformat("MaterialX material type %s", String(category_name.c_str())));
-			for (mx::InputPtr input : node_inputs->getInputs()) {
-				const std::string &input_name = input->getName();
-				print_verbose(vformat("MaterialX input %s", String(input_name.c_str())));
-				if (input->hasOutputString()) {
-					mx::NodeGraphPtr node_graph = new_doc->getChildOfType<mx::NodeGraph>(input->getNodeGraphString());
-					if (!node_graph) {
-						continue;
-					}
-					mx::OutputPtr output = node_graph->getOutput(input->getOutputString());
-					mx::NodePtr image_node = node_graph->getNode(output->getNodeName());
-					if (!image_node) {
-						continue;
-					}
-					if (!image_node->getInputs().size()) {
-						continue;
-					}
-					String filepath = image_node->getInputs()[0]->getValueString().c_str();
-					if (input_name == "normal") {
-						mx::NodePtr normal_image_node = node_graph->getNode(image_node->getInputs()[0]->getNodeName());
-						if (!normal_image_node->getInputs().size()) {
-							continue;
-						}
-						filepath = normal_image_node->getInputs()[0]->getValueString().c_str();
-					}
-					filepath = filepath.replace("\\", "/");
-					filepath = ProjectSettings::get_singleton()->localize_path(filepath);
-					filepath = filepath.lstrip("res://");
-					String line = vformat("MaterialX attribute filepath %s", filepath);
-					print_verbose(vformat("MaterialX attribute name %s", String(input->getOutputString().c_str())));
-					print_verbose(line);
-					Ref<ImageTexture> tex;
-					tex.instantiate();
-					Ref<Image> mtlx_image;
-					mtlx_image.instantiate();
-					err = ImageLoader::load_image(filepath, mtlx_image);
-					if (err == OK) {
-						mtlx_image->generate_mipmaps();
-						tex->create_from_image(mtlx_image);
+	}
+	ERR_FAIL_COND_V_MSG(bake_materials.size() != (size_t)p_names.size(), ERR_DOES_NOT_EXIST, vformat("Materials to bake not found in %s", p_path));
+
+	String folder = MTLXImportCache::get_import_folder(p_path);
+	DirAccessRef d = DirAccess::create(DirAccess::ACCESS_RESOURCES);
+	d->make_dir_recursive(folder);
+	return _bake_materials(doc, std_lib, context, search_path, folder, bake_materials, p_settings, r_documents, nullptr);
+}
+
+RES MTLXLoader::load(const String &p_path, const String &p_original_path, Error *r_error, bool p_use_sub_threads, float *r_progress, CacheMode p_cache_mode) {
+	MTLXProfiler::register_monitors();
+	MTLXProfiler::Stats stats;
+	MTLXProfiler::Scope import_scope(MTLXProfiler::PHASE_IMPORT, &stats);
+
+	MTLXBakeSettings bake_settings;
+	bake_settings.cpu = force_cpu_baking || bool(GLOBAL_GET("material_x/import/cpu_baking"));
+	bool generate_shaders = GLOBAL_GET("material_x/import/generate_shaders");
+	String bake_options = bake_settings.to_string() + "," + (generate_shaders ? "true" : "false");
+	RES cached = MTLXImportCache::load(p_path, bake_options);
+	MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_IMPORT, cached.is_valid(), &stats);
+	bool stream = texture_streaming && MTLXTextureStreamer::is_enabled();
+	if (cached.is_valid()) {
+		// The stored textures may still be previews.
+		MTLXTextureStreamer::resume(cached, stream);
+		if (r_progress) {
+			*r_progress = 1.0f;
+		}
+		if (r_error) {
+			*r_error = OK;
+		}
+		return cached;
+	}
+
+	mx::GenContext context = mx::GlslShaderGenerator::create();
+	String folder = MTLXImportCache::get_import_folder(p_path);
+	mx::FileSearchPath searchPath;
+	mx::DocumentPtr stdLib;
+	mx::StringSet dependencies;
+	mx::BakedDocumentVec baked_documents;
+	Vector<Ref<Material>> materials;
+	Vector<MTLXTextureJob> texture_jobs;
+	std::vector<mx::NodePtr> pending_materials;
+	Dictionary material_keys;
+	bool generated = false;
+	// Results missing materials are returned, but not cached.
+	Error bake_error = OK;
+	{
+		mx::DocumentPtr doc;
+		Error err = _open_document(p_path, context, searchPath, stdLib, doc, &dependencies, &stats);
+		if (err != OK) {
+			if (r_error) {
+				*r_error = err;
+			}
+			return RES();
+		}
+		collect_image_dependencies(doc, searchPath, dependencies);
+
+		// Take the materials whose definition and dependencies are unchanged
+		// from the previous import; only the others are generated or baked.
+		RES previous = MTLXImportCache::load_previous(p_path);
+		Dictionary previous_keys = MTLXImportCache::get_material_keys(p_path);
+		HashMap<String, String> md5_cache;
+		std::vector<mx::TypedElementPtr> renderable_materials;
+		findRenderableElements(doc, renderable_materials);
+		for (size_t i = 0; i < renderable_materials.size(); i++) {
+			const mx::TypedElementPtr &element = renderable_materials[i];
+			mx::NodePtr material_node = element ? element->asA<mx::Node>() : nullptr;
+			if (!material_node) {
+				continue;
+			}
+			mx::StringSet material_dependencies;
+			String definition_hash = hash_material_definition(material_node, searchPath, material_dependencies);
+			Vector<String> material_dependency_paths;
+			for (const std::string &dependency : material_dependencies) {
+				material_dependency_paths.push_back(String(dependency.c_str()));
+				dependencies.insert(dependency);
+			}
+			String name = material_node->getName().c_str();
+			String key = MTLXImportCache::compute_key(bake_options + "|" + definition_hash, material_dependency_paths, &md5_cache);
+			material_keys[name] = key;
+			Ref<Material> reused = String(previous_keys.get(name, String())) == key ? get_previous_material(previous, name) : Ref<Material>();
+			if (reused.is_valid()) {
+				MTLXTextureStreamer::resume(reused, stream);
+				materials.push_back(reused);
+			} else {
+				pending_materials.push_back(material_node);
+			}
+		}
+		if (previous.is_valid()) {
+			print_verbose(vformat("MaterialX reimport of %s reuses %d of %d materials", p_path, materials.size(), materials.size() + (int)pending_materials.size()));
+		}
+		if (r_progress) {
+			*r_progress = 0.2f;
+		}
+
+		if (generate_shaders) {
+			// Run the graphs directly in Godot shaders, falling back to baking
+			// when one of them can't be translated.
+			mx::GenContext shader_context(MTLXGodotShaderGenerator::create());
+			for (const mx::FilePath &path : searchPath) {
+				shader_context.registerSourceCodeSearchPath(path / "libraries");
+			}
+			mx::DefaultColorManagementSystemPtr cms = mx::DefaultColorManagementSystem::create(shader_context.getShaderGenerator().getTarget());
+			cms->loadLibrary(stdLib);
+			shader_context.getShaderGenerator().setColorManagementSystem(cms);
+			shader_context.getOptions().targetColorSpaceOverride = "lin_rec709";
+			shader_context.getOptions().fileTextureVerticalFlip = true;
+			shader_context.getOptions().hwSpecularEnvironmentMethod = mx::SPECULAR_ENVIRONMENT_NONE;
+			int reused_count = materials.size();
+			try {
+				for (size_t i = 0; i < pending_materials.size(); i++) {
+					Ref<ShaderMaterial> mat = create_shader_material(pending_materials[i], materials.size(), shader_context, searchPath, texture_jobs, &stats);
+					if (mat.is_null()) {
+						materials.resize(reused_count);
+						break;
 					}
-					if (input_name == "base_color") {
-						mat->set_flag(BaseMaterial3D::FLAG_ALBEDO_TEXTURE_FORCE_SRGB, true);
-						mat->set_texture(BaseMaterial3D::TextureParam::TEXTURE_ALBEDO, tex);
-					} else if (input_name == "metallic") {
-						if (mat->get_metallic() == 0.0f) {
-							mat->set_metallic(1.0f);
-						}
-						mat->set_metallic_texture_channel(BaseMaterial3D::TEXTURE_CHANNEL_BLUE);
-						mat->set_texture(BaseMaterial3D::TEXTURE_METALLIC, tex);
-					} else if (input_name == "roughness") {
-						mat->set_texture(BaseMaterial3D::TEXTURE_ROUGHNESS, tex);
-						mat->set_roughness_texture_channel(BaseMaterial3D::TEXTURE_CHANNEL_GREEN);
-					} else if (input_name == "normal") {
-						mat->set_feature(StandardMaterial3D::FEATURE_NORMAL_MAPPING, true);
-						mat->set_texture(StandardMaterial3D::TEXTURE_NORMAL, tex);
-					} else if (input_name == "emissive_color") {
-						mat->set_feature(BaseMaterial3D::FEATURE_EMISSION, true);
-						mat->set_texture(BaseMaterial3D::TEXTURE_EMISSION, tex);
-					} else if (input_name == "occlusion") {
-						mat->set_texture(BaseMaterial3D::TEXTURE_AMBIENT_OCCLUSION, tex);
-						mat->set_ao_texture_channel(BaseMaterial3D::TEXTURE_CHANNEL_RED);
+					materials.push_back(mat);
+					// Shared shaders are external resources the result depends on.
+					String shader_path = mat->get_shader()->get_path();
+					if (!shader_path.is_empty()) {
+						dependencies.insert(ProjectSettings::get_singleton()->globalize_path(shader_path).utf8().get_data());
 					}
-					continue;
 				}
-				Variant v = get_value_as_material_x_variant(input);
-				// <input name="transmission" type="float" value="0" />
-				// <input name="specular_color" type="color3" value="1, 1, 1" />
-				// <input name="ior" type="float" value="1.5" />
-				// <input name="alpha" type="float" value="1" />
-				// <input name="sheen_color" type="color3" value="0, 0, 0" />
-				// <input name="sheen_roughness" type="float" value="0" />
-				// <input name="clearcoat" type="float" value="0" />
-				// <input name="clearcoat_roughness" type="float" value="0" />
-				// <input name="clearcoat_normal" type="vector3" value="0, 0, 1" />
-				// <input name="emissive" type="color3" value="0, 0, 0" />
-				// <input name="thickness" type="float" value="0" />
-				// <input name="attenuation_distance" type="float" value="100000" />
-				// <input name="attenuation_color" type="color3" value="0, 0, 0" />
-				if (input_name == "base_color") {
-					Color c = mat->get_albedo();
-					Color variant_color = v;
-					c.r = variant_color.r;
-					c.g = variant_color.g;
-					c.b = variant_color.b;
-					c.a = variant_color.a;
-					mat->set_albedo(c);
-				} else if (input_name == "metallic") {
-					mat->set_metallic(v);
-				} else if (input_name == "roughness") {
-					mat->set_roughness(v);
-				} else if (input_name == "specular") {
-					mat->set_specular(v);
-				} else if (input_name == "normal") {
-					mat->set_feature(StandardMaterial3D::FEATURE_NORMAL_MAPPING, true);
-				} else if (input_name == "emissive") {
-					mat->set_feature(BaseMaterial3D::FEATURE_EMISSION, true);
-					mat->set_emission(v);
-				} else if (input_name == "alpha_mode") {
-					if (v) {
-						mat->set_transparency(BaseMaterial3D::TRANSPARENCY_ALPHA);
-						mat->set_alpha_antialiasing(BaseMaterial3D::ALPHA_ANTIALIASING_ALPHA_TO_COVERAGE_AND_TO_ONE);
-						mat->set_depth_draw_mode(BaseMaterial3D::DEPTH_DRAW_ALWAYS);
-					}
-				} else if (input_name == "alpha_cutoff") {
-					mat->set_transparency(BaseMaterial3D::TRANSPARENCY_ALPHA_SCISSOR);
-					mat->set_depth_draw_mode(BaseMaterial3D::DEPTH_DRAW_ALWAYS);
-					mat->set_alpha_scissor_threshold(v);
-				} else if (input_name == "base_color") {
-					Color c = mat->get_albedo();
-					c.a = c.a * Color(v).a;
-					mat->set_albedo(c);
+			} catch (std::exception &e) {
+				print_verbose(vformat("MaterialX shader generation failed for %s: %s", p_path, String(e.what())));
+				materials.resize(reused_count);
+			}
+			if (materials.size() == reused_count) {
+				texture_jobs.clear();
+				if (!pending_materials.empty()) {
+					print_verbose(vformat("MaterialX falls back to baking %s", p_path));
 				}
-				print_verbose(vformat("MaterialX attribute value %s", v));
 			}
+			generated = materials.size() > reused_count;
+		}
+
+		std::vector<mx::TypedElementPtr> bake_materials;
+		if (!generated) {
+			DirAccessRef d = DirAccess::create(DirAccess::ACCESS_RESOURCES);
+			d->make_dir_recursive(folder);
+
+			// Materials that only read images as is map onto StandardMaterial3D
+			// directly; only the others are baked.
+			int mapped_count = 0;
+			for (size_t i = 0; i < pending_materials.size(); i++) {
+				const mx::NodePtr &material_node = pending_materials[i];
+				if (is_direct_material(material_node)) {
+					materials.push_back(create_standard_material(material_node, materials.size(), searchPath, folder, texture_jobs));
+					mapped_count++;
+				} else {
+					bake_materials.push_back(material_node);
+				}
+			}
+			print_verbose(vformat("MaterialX maps %d of %d materials in %s without baking", mapped_count, (int)pending_materials.size(), p_path));
+		}
+
+		if (!bake_materials.empty()) {
+			int worker_count = bake_workers ? int(GLOBAL_GET("material_x/import/bake_workers")) : 0;
+			if (worker_count > 0) {
+				bake_error = MTLXBakeWorker::bake(p_path, bake_materials, bake_settings, worker_count, baked_documents);
+			} else {
+				bake_error = _bake_materials(doc, stdLib, context, searchPath, folder, bake_materials, bake_settings, baked_documents, &stats);
+			}
+			if (r_progress) {
+				*r_progress = 0.6f;
+			}
+		}
+	}
+
+	// Map every material of every baked document, collecting the textures they
+	// reference so they can be decoded together. Baked documents hold plain
+	// material, shader and image nodes, so they need no library to be read.
+	for (size_t baked_index = 0; baked_index < baked_documents.size(); baked_index++) {
+		mx::DocumentPtr baked_doc = baked_documents[baked_index].second;
+		for (mx::NodePtr material_node : baked_doc->getMaterialNodes()) {
+			materials.push_back(create_standard_material(material_node, materials.size(), searchPath, folder, texture_jobs));
+		}
+	}
+	if (materials.is_empty()) {
+		ERR_PRINT(vformat("No renderable MaterialX materials in %s", p_path));
+		if (r_error) {
+			*r_error = bake_error != OK ? bake_error : ERR_INVALID_DATA;
+		}
+		return RES();
+	}
+	if (r_progress) {
+		*r_progress = 0.7f;
+	}
+
+	for (int i = 0; i < materials.size() && !generated; i++) {
+		String packed_path = folder + p_path.get_file().get_basename() + (materials.size() > 1 ? "_" + materials[i]->get_name() : String()) + "_orm.png";
+		pack_orm_textures(texture_jobs, i, packed_path, &stats);
+	}
+
+	// Decode and mipmap every baked texture, in parallel when the caller allows it,
+	// reusing textures already loaded for other materials.
+	_load_texture_jobs(texture_jobs, p_use_sub_threads, &stats);
+	for (int i = 0; i < texture_jobs.size(); i++) {
+		const MTLXTextureJob &job = texture_jobs[i];
+		if (generated) {
+			Ref<ShaderMaterial>(materials[job.material_index])->set_shader_param(job.input_name, job.texture);
+		} else {
+			apply_texture_to_material(materials[job.material_index], job.input_name, job.texture, job.channel);
 		}
-		break;
+	}
+	if (r_progress) {
+		*r_progress = 0.95f;
+	}
+
+	RES result = materials[0];
+	if (materials.size() > 1) {
+		Ref<MTLXMaterialCollection> collection;
+		collection.instantiate();
+		for (int i = 0; i < materials.size(); i++) {
+			collection->add_material(materials[i]->get_name(), materials[i]);
+		}
+		result = collection;
+	}
+
+	Vector<String> dependency_paths;
+	for (const std::string &dependency : dependencies) {
+		dependency_paths.push_back(String(dependency.c_str()));
+	}
+	if (bake_error == OK) {
+		MTLXImportCache::save(p_path, bake_options, dependency_paths, result, material_keys);
+	} else {
+		WARN_PRINT(vformat("MaterialX import of %s is incomplete and isn't cached", p_path));
+	}
+	import_scope.end();
+	print_verbose(vformat("MaterialX import of %s: %s", p_path, MTLXProfiler::get_summary(stats)));
+	if (r_progress) {
+		*r_progress = 1.0f;
 	}
 	if (r_error) {
-		*r_error = OK;
+		*r_error = bake_error;
 	}
-	return mat;
+	return result;
 }
 
 void MTLXLoader::get_recognized_extensions(List<String> *p_extensions) const {
@@ -461,12 +1339,18 @@ void MTLXLoader::get_recognized_extensions(List<String> *p_extensions) const {
 }
 
 bool MTLXLoader::handles_type(const String &p_type) const {
-	return (p_type == "StandardMaterial3D");
+	return (p_type == "StandardMaterial3D" || p_type == "ShaderMaterial" || p_type == "MTLXMaterialCollection");
 }
 
 String MTLXLoader::get_resource_type(const String &p_path) const {
 	if (p_path.get_extension().to_lower() == "mtlx") {
-		return "StandardMaterial3D";
+		// Documents with several materials load as a collection; that is only
+		// known once the document has been imported.
+		String type = MTLXImportCache::get_resource_type(p_path);
+		if (type.is_empty()) {
+			type = GLOBAL_GET("material_x/import/generate_shaders") ? "ShaderMaterial" : "StandardMaterial3D";
+		}
+		return type;
 	}
 	return "";
 }
@@ -1,8 +1,13 @@
 #pragma once
 
+#include "material_x_profiler.h"
+
 #include "core/io/resource_loader.h"
+#include "core/os/mutex.h"
+#include "core/templates/thread_work_pool.h"
 #include "scene/resources/material.h"
 
+#include <MaterialXRenderGlsl/CpuTextureBaker.h>
 #include <MaterialXRenderGlsl/GLTextureHandler.h>
 #include <MaterialXRenderGlsl/GLUtil.h>
 #include <MaterialXRenderGlsl/TextureBaker.h>
@@ -27,15 +32,81 @@
 #include <iostream>
 
 namespace mx = MaterialX;
+
+// A baked texture referenced by a shader input. Images are decoded off the
+// loading thread; the resulting texture is shared through MTLXTextureCache.
+struct MTLXTextureJob {
+	int material_index = 0;
+	String input_name;
+	String path;
+	// Baked images are VRAM-compressed and stored in the import folder; source
+	// images referenced by generated shaders are only mipmapped.
+	bool store_compressed = true;
+	// Folder holding the compressed image when it isn't stored next to the
+	// image, as for source images mapped without baking.
+	String compressed_folder;
+	// Channel sampled by float inputs, or -1 for the layout of packed ORM images.
+	int channel = -1;
+	// Bind a preview of the lowest mips when one is stored, and stream the full
+	// image from stream_path afterwards.
+	bool stream = false;
+	String stream_path;
+	// Size of the full image once streamed in.
+	uint64_t stream_size = 0;
+	// Where the texture is saved for the materials to reference it.
+	String texture_path;
+	MTLXProfiler::Stats *stats = nullptr;
+	Ref<Image> image;
+	Error error = OK;
+	Ref<Texture2D> texture;
+};
+
+// Texture baking parameters. The size defaults to the largest image the
+// document reads; EXR output needs OpenImageIO.
+struct MTLXBakeSettings {
+	int width = -1;
+	int height = -1;
+	std::string format;
+	bool average = false;
+	bool optimize = true;
+	bool cpu = false;
+
+	String to_string() const;
+	static MTLXBakeSettings from_string(const String &p_string);
+};
+
 class MTLXLoader : public ResourceFormatLoader {
 
 	mx::ImageHandlerPtr imageHandler = mx::GLTextureHandler::create(mx::StbImageLoader::create());
+	// Bake with the CPU texture baker regardless of the project setting, for hosts without a GPU.
+	bool force_cpu_baking = false;
+	// Stream full-resolution textures in after load, when the project setting allows it.
+	bool texture_streaming = true;
+	// Hand bakes to worker processes, when the project setting asks for them.
+	bool bake_workers = true;
+	// Threads decoding textures, started by the first load that needs them and
+	// kept for the following ones. Loads take turns using them.
+	ThreadWorkPool decode_pool;
+	Mutex decode_pool_mutex;
+	bool decode_pool_started = false;
+
+	Error _open_document(const String &p_path, mx::GenContext &p_context, mx::FileSearchPath &r_search_path, mx::DocumentPtr &r_std_lib, mx::DocumentPtr &r_doc, mx::StringSet *r_dependencies, MTLXProfiler::Stats *p_stats);
+	Error _bake_materials(mx::DocumentPtr p_doc, mx::DocumentPtr p_std_lib, const mx::GenContext &p_context, const mx::FileSearchPath &p_search_path, const String &p_folder, const std::vector<mx::TypedElementPtr> &p_materials, MTLXBakeSettings p_settings, mx::BakedDocumentVec &r_documents, MTLXProfiler::Stats *p_stats);
+	void _decode_texture_job(uint32_t p_index, MTLXTextureJob *p_jobs);
+	void _load_texture_jobs(Vector<MTLXTextureJob> &r_jobs, bool p_use_sub_threads, MTLXProfiler::Stats *p_stats);
 
 public:
 	virtual RES load(const String &p_path, const String &p_original_path = "", Error *r_error = nullptr, bool p_use_sub_threads = false, float *r_progress = nullptr, CacheMode p_cache_mode = CACHE_MODE_REUSE);
 	virtual void get_recognized_extensions(List<String> *p_extensions) const;
 	virtual bool handles_type(const String &p_type) const;
 	virtual String get_resource_type(const String &p_path) const;
+	void set_force_cpu_baking(bool p_enable) { force_cpu_baking = p_enable; }
+	void set_texture_streaming(bool p_enable) { texture_streaming = p_enable; }
+	void set_bake_workers(bool p_enable) { bake_workers = p_enable; }
+	// Bakes the named materials of a document into its import folder, in this process.
+	Error bake_materials(const String &p_path, const Vector<String> &p_names, const MTLXBakeSettings &p_settings, mx::BakedDocumentVec &r_documents);
+	// Stops the texture decoding threads.
+	void finish();
 	MTLXLoader() {}
 };
 
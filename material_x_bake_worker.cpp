@@ -0,0 +1,125 @@
+#include "material_x_bake_worker.h"
+#include "material_x_3d.h"
+
+#include "core/config/project_settings.h"
+#include "core/os/os.h"
+#include "core/templates/thread_work_pool.h"
+
+#include <MaterialXFormat/XmlIo.h>
+
+static const char *MTLX_DOCUMENT_BEGIN = "[materialx-baked-document] ";
+static const char *MTLX_DOCUMENT_END = "[materialx-baked-document-end]";
+
+bool MTLXBakeWorker::is_requested() {
+	return OS::get_singleton()->get_cmdline_args().find("--mtlx-bake-worker") != nullptr;
+}
+
+void MTLXBakeWorker::_run_process(uint32_t p_index, Process *p_processes) {
+	Process &process = p_processes[p_index];
+	List<String> args;
+	args.push_back("--headless");
+	args.push_back("--path");
+	args.push_back(ProjectSettings::get_singleton()->get_resource_path());
+	args.push_back("--mtlx-bake-worker");
+	args.push_back(process.path);
+	args.push_back("--mtlx-bake-materials");
+	args.push_back(String(",").join(process.materials));
+	args.push_back("--mtlx-bake-settings");
+	args.push_back(process.settings);
+	process.error = OS::get_singleton()->execute(OS::get_singleton()->get_executable_path(), args, &process.output, &process.exit_code);
+}
+
+void MTLXBakeWorker::_read_documents(const String &p_output, mx::BakedDocumentVec &r_documents) {
+	Vector<String> lines = p_output.split("\n");
+	String name;
+	String xml;
+	bool reading = false;
+	for (int i = 0; i < lines.size(); i++) {
+		String line = lines[i].trim_suffix("\r");
+		if (line.begins_with(MTLX_DOCUMENT_BEGIN)) {
+			name = line.trim_prefix(MTLX_DOCUMENT_BEGIN);
+			xml = String();
+			reading = true;
+		} else if (reading && line == MTLX_DOCUMENT_END) {
+			reading = false;
+			mx::DocumentPtr doc = mx::createDocument();
+			try {
+				mx::readFromXmlString(doc, xml.utf8().get_data());
+			} catch (std::exception &e) {
+				ERR_PRINT(vformat("Can't read MaterialX document baked for %s: %s", name, String(e.what())));
+				continue;
+			}
+			r_documents.push_back(std::make_pair(std::string(name.utf8().get_data()), doc));
+		} else if (reading) {
+			xml += line + "\n";
+		}
+	}
+}
+
+Error MTLXBakeWorker::bake(const String &p_path, const std::vector<mx::TypedElementPtr> &p_materials, const MTLXBakeSettings &p_settings, int p_worker_count, mx::BakedDocumentVec &r_documents) {
+	// Deal the materials out to the workers.
+	Vector<Process> processes;
+	processes.resize(MIN(p_worker_count, (int)p_materials.size()));
+	for (int i = 0; i < processes.size(); i++) {
+		processes.write[i].path = p_path;
+		processes.write[i].settings = p_settings.to_string();
+	}
+	for (size_t i = 0; i < p_materials.size(); i++) {
+		processes.write[i % processes.size()].materials.push_back(String(p_materials[i]->getName().c_str()));
+	}
+
+	MTLXBakeWorker *worker = memnew(MTLXBakeWorker);
+	ThreadWorkPool work_pool;
+	work_pool.init(processes.size());
+	work_pool.do_work(processes.size(), worker, &MTLXBakeWorker::_run_process, processes.ptrw());
+	work_pool.finish();
+	memdelete(worker);
+
+	Error err = OK;
+	for (int i = 0; i < processes.size(); i++) {
+		const Process &process = processes[i];
+		// Documents written before a failure are complete, with their images.
+		_read_documents(process.output, r_documents);
+		if (process.error != OK || process.exit_code != 0) {
+			ERR_PRINT(vformat("MaterialX bake worker failed for %s in %s (exit code %d)", String(", ").join(process.materials), p_path, process.exit_code));
+			err = ERR_CANT_CREATE;
+		}
+	}
+	print_verbose(vformat("MaterialX baked %d materials of %s in %d worker processes", (int)p_materials.size(), p_path, processes.size()));
+	return err;
+}
+
+void MTLXBakeWorker::initialize() {
+	MainLoop::initialize();
+
+	String path;
+	Vector<String> materials;
+	MTLXBakeSettings settings;
+	List<String> args = OS::get_singleton()->get_cmdline_args();
+	for (const List<String>::Element *E = args.front(); E && E->next(); E = E->next()) {
+		const String &value = E->next()->get();
+		if (E->get() == "--mtlx-bake-worker") {
+			path = value;
+		} else if (E->get() == "--mtlx-bake-materials") {
+			materials = value.split(",", false);
+		} else if (E->get() == "--mtlx-bake-settings") {
+			settings = MTLXBakeSettings::from_string(value);
+		}
+	}
+
+	Ref<MTLXLoader> loader;
+	loader.instantiate();
+	mx::BakedDocumentVec documents;
+	Error err = loader->bake_materials(path, materials, settings, documents);
+	for (const std::pair<std::string, mx::DocumentPtr> &document : documents) {
+		print_line(MTLX_DOCUMENT_BEGIN + String::utf8(document.first.c_str()));
+		print_line(String::utf8(mx::writeToXmlString(document.second).c_str()));
+		print_line(MTLX_DOCUMENT_END);
+	}
+	OS::get_singleton()->set_exit_code(err == OK ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+bool MTLXBakeWorker::process(double p_time) {
+	// Everything runs in initialize(); quit on the first frame.
+	return true;
+}
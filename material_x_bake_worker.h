@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/os/main_loop.h"
+#include "core/templates/vector.h"
+
+#include <MaterialXRenderGlsl/TextureBaker.h>
+
+namespace mx = MaterialX;
+
+struct MTLXBakeSettings;
+
+// Texture baking in child processes of the engine, so that a slow or crashing
+// bake doesn't take the editor down and materials bake in parallel, each
+// worker with its own GL context. Workers run instead of the scene tree when
+// Godot is started with
+//
+//   --mtlx-bake-worker <path> --mtlx-bake-materials <names> --mtlx-bake-settings <settings>
+//
+// They bake the named materials into the import folder of the document and
+// write the baked documents to their standard output, where the loader reads
+// them back. A worker that fails only loses its own materials.
+class MTLXBakeWorker : public MainLoop {
+	GDCLASS(MTLXBakeWorker, MainLoop);
+
+	struct Process {
+		String path;
+		Vector<String> materials;
+		String settings;
+		String output;
+		int exit_code = 0;
+		Error error = OK;
+	};
+
+	void _run_process(uint32_t p_index, Process *p_processes);
+	static void _read_documents(const String &p_output, mx::BakedDocumentVec &r_documents);
+
+public:
+	static bool is_requested();
+	// Bakes materials of a document in up to p_worker_count worker processes.
+	// Fails when any worker does, returning the documents of the others.
+	static Error bake(const String &p_path, const std::vector<mx::TypedElementPtr> &p_materials, const MTLXBakeSettings &p_settings, int p_worker_count, mx::BakedDocumentVec &r_documents);
+
+	virtual void initialize() override;
+	virtual bool process(double p_time) override;
+};
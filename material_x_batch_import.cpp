@@ -0,0 +1,138 @@
+#include "material_x_batch_import.h"
+#include "material_x_3d.h"
+#include "material_x_profiler.h"
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/io/json.h"
+#include "core/os/os.h"
+#include "core/templates/thread_work_pool.h"
+
+bool MTLXBatchImport::is_requested() {
+	return OS::get_singleton()->get_cmdline_args().find("--mtlx-batch-import") != nullptr;
+}
+
+void MTLXBatchImport::_add_path(const String &p_path) {
+	if (p_path.get_extension().to_lower() == "mtlx") {
+		File file;
+		file.path = p_path;
+		files.push_back(file);
+		return;
+	}
+	DirAccessRef dir = DirAccess::open(p_path);
+	if (!dir) {
+		ERR_PRINT(vformat("MaterialX batch import can't open %s", p_path));
+		return;
+	}
+	dir->list_dir_begin();
+	for (String name = dir->get_next(); !name.is_empty(); name = dir->get_next()) {
+		// Skip hidden folders such as .godot, and the data libraries.
+		if (name.begins_with(".") || (dir->current_is_dir() && p_path.plus_file(name) == "res://libraries")) {
+			continue;
+		}
+		if (dir->current_is_dir() || name.get_extension().to_lower() == "mtlx") {
+			_add_path(p_path.plus_file(name));
+		}
+	}
+	dir->list_dir_end();
+}
+
+void MTLXBatchImport::_import_file(uint32_t p_index, File *p_files) {
+	File &file = p_files[p_index];
+	// Each file gets its own loader, whose image handler isn't thread-safe.
+	Ref<MTLXLoader> loader;
+	loader.instantiate();
+	loader->set_force_cpu_baking(true);
+	// Nothing renders, so there is no point streaming textures in.
+	loader->set_texture_streaming(false);
+	// Files already import in parallel here.
+	loader->set_bake_workers(false);
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	Error err = FAILED;
+	RES resource = loader->load(file.path, file.path, &err, false, nullptr, ResourceFormatLoader::CACHE_MODE_IGNORE);
+	file.usec = OS::get_singleton()->get_ticks_usec() - begin;
+	// Materials the CPU baker can't bake leave the result incomplete, which
+	// counts as a failure even though the rest is returned.
+	file.error = err != OK ? err : (resource.is_valid() ? OK : FAILED);
+	file.type = resource.is_valid() ? resource->get_class() : String();
+}
+
+Error MTLXBatchImport::_write_report(uint64_t p_usec) const {
+	Array entries;
+	int failed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		Dictionary entry;
+		entry["path"] = files[i].path;
+		entry["error"] = files[i].error == OK ? String() : String(error_names[files[i].error]);
+		entry["type"] = files[i].type;
+		entry["time_ms"] = files[i].usec / 1000.0;
+		entries.push_back(entry);
+		failed += files[i].error != OK;
+	}
+	Dictionary report;
+	report["files"] = entries;
+	report["failed"] = failed;
+	report["threads"] = thread_count;
+	report["time_ms"] = p_usec / 1000.0;
+	report["profile"] = MTLXProfiler::get_summary(MTLXProfiler::get_totals());
+
+	Error err;
+	FileAccessRef f = FileAccess::open(report_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, vformat("Can't write MaterialX batch import report %s", report_path));
+	f->store_string(JSON::stringify(report, "\t", false));
+	return OK;
+}
+
+void MTLXBatchImport::initialize() {
+	MainLoop::initialize();
+
+	List<String> args = OS::get_singleton()->get_cmdline_args();
+	for (const List<String>::Element *E = args.front(); E && E->next(); E = E->next()) {
+		const String &value = E->next()->get();
+		if (E->get() == "--mtlx-batch-import") {
+			Vector<String> paths = value.split(",", false);
+			for (int i = 0; i < paths.size(); i++) {
+				_add_path(paths[i].strip_edges());
+			}
+		} else if (E->get() == "--mtlx-threads") {
+			thread_count = value.to_int();
+		} else if (E->get() == "--mtlx-report") {
+			report_path = value;
+		}
+	}
+	if (thread_count <= 0) {
+		thread_count = OS::get_singleton()->get_processor_count();
+	}
+	thread_count = CLAMP(thread_count, 1, MAX(files.size(), 1));
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	if (files.size()) {
+		ThreadWorkPool work_pool;
+		work_pool.init(thread_count);
+		work_pool.do_work(files.size(), this, &MTLXBatchImport::_import_file, files.ptrw());
+		work_pool.finish();
+	}
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+	int failed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		const File &file = files[i];
+		if (file.error == OK) {
+			print_line(vformat("%.1f ms\t%s (%s)", file.usec / 1000.0, file.path, file.type));
+		} else {
+			print_line(vformat("FAILED\t%s: %s", file.path, error_names[file.error]));
+			failed++;
+		}
+	}
+	print_line(vformat("MaterialX batch import: %d files, %d failed, %.1f s on %d threads", files.size(), failed, usec / 1000000.0, thread_count));
+	print_line(MTLXProfiler::get_summary(MTLXProfiler::get_totals()));
+	if (!report_path.is_empty()) {
+		_write_report(usec);
+	}
+	OS::get_singleton()->set_exit_code(failed || files.is_empty() ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+bool MTLXBatchImport::process(double p_time) {
+	// Everything runs in initialize(); quit on the first frame.
+	return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "core/os/main_loop.h"
+#include "core/templates/vector.h"
+
+// Headless batch import of MaterialX documents, run instead of the scene tree
+// when Godot is started with
+//
+//   --mtlx-batch-import <paths> [--mtlx-threads <count>] [--mtlx-report <file>]
+//
+// where <paths> is a comma-separated list of .mtlx files and folders searched
+// recursively. Files are imported in parallel on a worker pool, sharing the
+// library document and the texture cache, and baked on the CPU so no GPU is
+// needed. A per-file timing and failure report is printed and optionally
+// written as JSON; the exit code is non-zero when any file failed.
+class MTLXBatchImport : public MainLoop {
+	GDCLASS(MTLXBatchImport, MainLoop);
+
+	struct File {
+		String path;
+		Error error = OK;
+		String type;
+		uint64_t usec = 0;
+	};
+
+	Vector<File> files;
+	String report_path;
+	int thread_count = 0;
+
+	void _add_path(const String &p_path);
+	void _import_file(uint32_t p_index, File *p_files);
+	Error _write_report(uint64_t p_usec) const;
+
+public:
+	static bool is_requested();
+
+	virtual void initialize() override;
+	virtual bool process(double p_time) override;
+};
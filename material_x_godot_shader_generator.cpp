@@ -0,0 +1,404 @@
+#include "material_x_godot_shader_generator.h"
+
+#include "servers/rendering/shader_language.h"
+#include "servers/rendering/shader_types.h"
+
+#include <MaterialXGenGlsl/GlslSyntax.h>
+#include <MaterialXGenShader/Shader.h>
+#include <MaterialXGenShader/ShaderGraph.h>
+#include <MaterialXGenShader/Syntax.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+namespace {
+
+// Surface shader inputs understood by the generator, for standard_surface,
+// gltf_pbr and UsdPreviewSurface, with the spatial shader output they drive.
+struct MTLXSurfaceOutput {
+	const char *input;
+	const char *weight;
+	const char *builtin;
+	size_t size;
+};
+
+const MTLXSurfaceOutput surface_outputs[] = {
+	{ "base_color", "base", "ALBEDO", 3 },
+	{ "diffuseColor", nullptr, "ALBEDO", 3 },
+	{ "metalness", nullptr, "METALLIC", 1 },
+	{ "metallic", nullptr, "METALLIC", 1 },
+	{ "specular_roughness", nullptr, "ROUGHNESS", 1 },
+	{ "roughness", nullptr, "ROUGHNESS", 1 },
+	{ "emission_color", "emission", "EMISSION", 3 },
+	{ "emissive", nullptr, "EMISSION", 3 },
+	{ "emissiveColor", nullptr, "EMISSION", 3 },
+	{ "occlusion", nullptr, "AO", 1 },
+	{ "opacity", nullptr, "ALPHA", 1 },
+	{ "alpha", nullptr, "ALPHA", 1 },
+	{ "normal", nullptr, "NORMAL", 3 },
+};
+
+// Convert an expression of p_from components to one of p_to components.
+std::string resize_expression(const std::string &p_expression, size_t p_from, size_t p_to) {
+	if (p_from == p_to) {
+		return p_expression;
+	}
+	if (p_from == 1) {
+		return "vec" + std::to_string(p_to) + "(" + p_expression + ")";
+	}
+	if (p_to == 1) {
+		// Scalar outputs fed by colors take their average.
+		return "dot(" + p_expression + ".xyz, vec3(1.0 / 3.0))";
+	}
+	if (p_to < p_from) {
+		return p_expression + (p_to == 2 ? ".xy" : ".xyz");
+	}
+	std::string padding = p_from == 2 && p_to == 4 ? ", 0.0, 1.0" : (p_to == 4 ? ", 1.0" : ", 0.0");
+	return "vec" + std::to_string(p_to) + "(" + p_expression + padding + ")";
+}
+
+bool is_identifier_char(char p_char) {
+	return isalnum((unsigned char)p_char) || p_char == '_';
+}
+
+void replace_word(std::string &r_string, const std::string &p_word, const std::string &p_replacement) {
+	size_t pos = r_string.find(p_word);
+	while (pos != std::string::npos) {
+		size_t end = pos + p_word.size();
+		if ((pos == 0 || !is_identifier_char(r_string[pos - 1])) && (end >= r_string.size() || !is_identifier_char(r_string[end]))) {
+			r_string.replace(pos, p_word.size(), p_replacement);
+			end = pos + p_replacement.size();
+		}
+		pos = r_string.find(p_word, end);
+	}
+}
+
+// Godot shaders have no preprocessor, so inline the object-like macros of the
+// included library code and drop every other directive.
+std::string expand_directives(const std::string &p_code) {
+	std::vector<std::pair<std::string, std::string>> defines;
+	std::istringstream input(p_code);
+	std::string out;
+	std::string line;
+	while (std::getline(input, line)) {
+		size_t first = line.find_first_not_of(" \t");
+		if (first != std::string::npos && line[first] == '#') {
+			std::istringstream directive(line.substr(first + 1));
+			std::string keyword, name, value;
+			directive >> keyword >> name;
+			std::getline(directive, value);
+			if (keyword == "define" && name.find('(') == std::string::npos) {
+				value = value.substr(std::min(value.find_first_not_of(" \t"), value.size()));
+				for (const auto &define : defines) {
+					replace_word(value, define.first, define.second);
+				}
+				defines.emplace_back(name, value);
+			}
+			continue;
+		}
+		for (const auto &define : defines) {
+			replace_word(line, define.first, define.second);
+		}
+		out += line + "\n";
+	}
+	return out;
+}
+
+// Fixed notation, as Godot rejects scientific notation and integer literals
+// where floats are expected. Literals are formatted here rather than through
+// the float format of mx::Value, which is global to every thread.
+std::string format_float(float p_value) {
+	std::ostringstream out;
+	out.imbue(std::locale::classic());
+	out << std::fixed << std::setprecision(6) << p_value;
+	return out.str();
+}
+
+template <class T>
+bool format_vector(const mx::Value &p_value, std::string &r_components) {
+	if (!p_value.isA<T>()) {
+		return false;
+	}
+	const T &vector = p_value.asA<T>();
+	for (size_t i = 0; i < T::numElements(); i++) {
+		r_components += (i ? ", " : "") + format_float(vector[i]);
+	}
+	return true;
+}
+
+template <class T>
+bool format_matrix(const mx::Value &p_value, std::string &r_components) {
+	if (!p_value.isA<T>()) {
+		return false;
+	}
+	const T &matrix = p_value.asA<T>();
+	for (size_t i = 0; i < T::numRows(); i++) {
+		for (size_t j = 0; j < T::numColumns(); j++) {
+			r_components += (i || j ? ", " : "") + format_float(matrix[i][j]);
+		}
+	}
+	return true;
+}
+
+// GLSL syntax writing float values in the form Godot accepts.
+class MTLXGodotSyntax : public mx::GlslSyntax {
+public:
+	std::string getValue(const mx::ShaderPort *p_port, bool p_uniform = false) const override {
+		if (p_port && p_port->getValue()) {
+			return getValue(p_port->getType(), *p_port->getValue(), p_uniform);
+		}
+		return mx::GlslSyntax::getValue(p_port, p_uniform);
+	}
+
+	std::string getValue(const mx::TypeDesc *p_type, const mx::Value &p_value, bool p_uniform = false) const override {
+		if (p_type == mx::Type::FLOAT && p_value.isA<float>()) {
+			return format_float(p_value.asA<float>());
+		}
+		std::string components;
+		if (format_vector<mx::Vector2>(p_value, components) || format_vector<mx::Vector3>(p_value, components) ||
+				format_vector<mx::Vector4>(p_value, components) || format_vector<mx::Color3>(p_value, components) ||
+				format_vector<mx::Color4>(p_value, components) || format_matrix<mx::Matrix33>(p_value, components) ||
+				format_matrix<mx::Matrix44>(p_value, components)) {
+			return getTypeName(p_type) + "(" + components + ")";
+		}
+		return mx::GlslSyntax::getValue(p_type, p_value, p_uniform);
+	}
+};
+
+ShaderLanguage::DataType get_global_variable_type(const StringName &p_variable) {
+	// Generated shaders read no global uniforms.
+	return ShaderLanguage::TYPE_VOID;
+}
+
+} // namespace
+
+MTLXGodotShaderGenerator::MTLXGodotShaderGenerator() {
+	_syntax = std::make_shared<MTLXGodotSyntax>();
+}
+
+mx::ShaderPtr MTLXGodotShaderGenerator::generate(const std::string &p_name, mx::ElementPtr p_element, mx::GenContext &p_context) const {
+	mx::ShaderPtr shader = createShader(p_name, p_element, p_context);
+
+	mx::ShaderStage &vs = shader->getStage(mx::Stage::VERTEX);
+	emitVertexStage(shader->getGraph(), p_context, vs);
+	replaceTokens(_tokenSubstitutions, vs);
+
+	mx::ShaderStage &ps = shader->getStage(mx::Stage::PIXEL);
+	emitPixelStage(shader->getGraph(), p_context, ps);
+	emitLineBreak(ps);
+	emitString(vs.getSourceCode(), ps);
+	replaceTokens(_tokenSubstitutions, ps);
+	ps.setSourceCode(expand_directives(ps.getSourceCode()));
+
+	return shader;
+}
+
+const std::string MTLXGodotShaderGenerator::getVertexDataPrefix(const mx::VariableBlock &p_vertex_data) const {
+	// Vertex data are declared as varyings, outside of any block.
+	return mx::EMPTY_STRING;
+}
+
+std::string MTLXGodotShaderGenerator::get_source_code(const mx::ShaderPtr &p_shader) {
+	return p_shader->getSourceCode(mx::Stage::PIXEL);
+}
+
+String MTLXGodotShaderGenerator::validate_source_code(const String &p_code) {
+	ShaderLanguage::ShaderCompileInfo info;
+	info.functions = ShaderTypes::get_singleton()->get_functions(RS::SHADER_SPATIAL);
+	info.render_modes = ShaderTypes::get_singleton()->get_modes(RS::SHADER_SPATIAL);
+	info.shader_types = ShaderTypes::get_singleton()->get_types();
+	info.global_variable_type_func = get_global_variable_type;
+
+	ShaderLanguage language;
+	if (language.compile(p_code, info) == OK) {
+		return String();
+	}
+	return vformat("line %d: %s", language.get_error_line(), language.get_error_text());
+}
+
+void MTLXGodotShaderGenerator::_emit_private_uniforms(mx::ShaderStage &p_stage) const {
+	// Engine state is read from the Godot built-ins instead of uniforms.
+	static const std::pair<const std::string *, const char *> builtins[] = {
+		{ &mx::HW::T_WORLD_MATRIX, "MODEL_MATRIX" },
+		{ &mx::HW::T_WORLD_INVERSE_MATRIX, "inverse(MODEL_MATRIX)" },
+		{ &mx::HW::T_WORLD_TRANSPOSE_MATRIX, "transpose(MODEL_MATRIX)" },
+		{ &mx::HW::T_WORLD_INVERSE_TRANSPOSE_MATRIX, "transpose(inverse(MODEL_MATRIX))" },
+		{ &mx::HW::T_VIEW_MATRIX, "VIEW_MATRIX" },
+		{ &mx::HW::T_VIEW_INVERSE_MATRIX, "INV_VIEW_MATRIX" },
+		{ &mx::HW::T_VIEW_TRANSPOSE_MATRIX, "transpose(VIEW_MATRIX)" },
+		{ &mx::HW::T_VIEW_INVERSE_TRANSPOSE_MATRIX, "transpose(INV_VIEW_MATRIX)" },
+		{ &mx::HW::T_PROJ_MATRIX, "PROJECTION_MATRIX" },
+		{ &mx::HW::T_PROJ_INVERSE_MATRIX, "inverse(PROJECTION_MATRIX)" },
+		{ &mx::HW::T_PROJ_TRANSPOSE_MATRIX, "transpose(PROJECTION_MATRIX)" },
+		{ &mx::HW::T_PROJ_INVERSE_TRANSPOSE_MATRIX, "transpose(inverse(PROJECTION_MATRIX))" },
+		{ &mx::HW::T_WORLD_VIEW_MATRIX, "VIEW_MATRIX * MODEL_MATRIX" },
+		{ &mx::HW::T_VIEW_PROJECTION_MATRIX, "PROJECTION_MATRIX * VIEW_MATRIX" },
+		{ &mx::HW::T_WORLD_VIEW_PROJECTION_MATRIX, "PROJECTION_MATRIX * VIEW_MATRIX * MODEL_MATRIX" },
+		{ &mx::HW::T_VIEW_POSITION, "INV_VIEW_MATRIX[3].xyz" },
+		{ &mx::HW::T_VIEW_DIRECTION, "-INV_VIEW_MATRIX[2].xyz" },
+		{ &mx::HW::T_TIME, "TIME" },
+		// MaterialX counts frames; assume 60 per second.
+		{ &mx::HW::T_FRAME, "floor(TIME * 60.0)" },
+	};
+
+	const mx::VariableBlock &uniforms = p_stage.getUniformBlock(mx::HW::PRIVATE_UNIFORMS);
+	for (size_t i = 0; i < uniforms.size(); i++) {
+		const mx::ShaderPort *uniform = uniforms[i];
+		if (uniform->getType() == mx::Type::FILENAME) {
+			// Lighting resources; Godot does the lighting itself.
+			continue;
+		}
+		std::string value;
+		for (const auto &builtin : builtins) {
+			if (uniform->getName() == *builtin.first) {
+				value = builtin.second;
+				break;
+			}
+		}
+		if (value.empty()) {
+			value = uniform->getValue() ? _syntax->getValue(uniform->getType(), *uniform->getValue()) : _syntax->getDefaultValue(uniform->getType());
+		}
+		emitLine(_syntax->getTypeName(uniform->getType()) + " " + uniform->getVariable() + " = " + value, p_stage);
+	}
+}
+
+void MTLXGodotShaderGenerator::emitVertexStage(const mx::ShaderGraph &p_graph, mx::GenContext &p_context, mx::ShaderStage &p_stage) const {
+	setFunctionName("vertex", p_stage);
+	emitLine("void vertex()", p_stage, false);
+	emitFunctionBodyBegin(p_graph, p_context, p_stage);
+
+	// Vertex inputs are read from the Godot built-ins, in model space.
+	const mx::VariableBlock &inputs = p_stage.getInputBlock(mx::HW::VERTEX_INPUTS);
+	for (size_t i = 0; i < inputs.size(); i++) {
+		const mx::ShaderPort *input = inputs[i];
+		const std::string &name = input->getName();
+		size_t size = input->getType()->getSize();
+		std::string value;
+		if (name == mx::HW::T_IN_POSITION) {
+			value = resize_expression("VERTEX", 3, size);
+		} else if (name == mx::HW::T_IN_NORMAL) {
+			value = resize_expression("NORMAL", 3, size);
+		} else if (name == mx::HW::T_IN_TANGENT) {
+			value = resize_expression("TANGENT", 3, size);
+		} else if (name == mx::HW::T_IN_TEXCOORD + "_0") {
+			value = resize_expression("UV", 2, size);
+		} else if (name == mx::HW::T_IN_TEXCOORD + "_1") {
+			value = resize_expression("UV2", 2, size);
+		} else if (name == mx::HW::T_IN_COLOR + "_0") {
+			value = resize_expression("COLOR", 4, size);
+		} else {
+			value = _syntax->getDefaultValue(input->getType());
+		}
+		emitLine(_syntax->getTypeName(input->getType()) + " " + input->getVariable() + " = " + value, p_stage);
+	}
+	_emit_private_uniforms(p_stage);
+	emitLine("vec4 hPositionWorld = " + mx::HW::T_WORLD_MATRIX + " * vec4(" + mx::HW::T_IN_POSITION + ", 1.0)", p_stage);
+
+	// Godot does the projection; only the vertex data of the nodes is written.
+	for (const mx::ShaderNode *node : p_graph.getNodes()) {
+		emitFunctionCall(*node, p_context, p_stage, false);
+	}
+
+	emitFunctionBodyEnd(p_graph, p_context, p_stage);
+}
+
+void MTLXGodotShaderGenerator::emitPixelStage(const mx::ShaderGraph &p_graph, mx::GenContext &p_context, mx::ShaderStage &p_stage) const {
+	emitLine("shader_type spatial", p_stage);
+	emitLineBreak(p_stage);
+
+	emitConstants(p_context, p_stage);
+
+	const mx::VariableBlock &uniforms = p_stage.getUniformBlock(mx::HW::PUBLIC_UNIFORMS);
+	if (!uniforms.empty()) {
+		emitVariableDeclarations(uniforms, _syntax->getUniformQualifier(), mx::Syntax::SEMICOLON, p_context, p_stage);
+		emitLineBreak(p_stage);
+	}
+
+	const mx::VariableBlock &vertex_data = p_stage.getInputBlock(mx::HW::VERTEX_DATA);
+	if (!vertex_data.empty()) {
+		emitVariableDeclarations(vertex_data, "varying", mx::Syntax::SEMICOLON, p_context, p_stage, false);
+		emitLineBreak(p_stage);
+	}
+
+	emitInclude("stdlib/" + mx::GlslShaderGenerator::TARGET + "/lib/mx_math.glsl", p_context, p_stage);
+	emitLineBreak(p_stage);
+
+	if (p_context.getOptions().fileTextureVerticalFlip) {
+		_tokenSubstitutions[mx::ShaderGenerator::T_FILE_TRANSFORM_UV] = "stdlib/" + mx::GlslShaderGenerator::TARGET + "/lib/mx_transform_uv_vflip.glsl";
+	} else {
+		_tokenSubstitutions[mx::ShaderGenerator::T_FILE_TRANSFORM_UV] = "stdlib/" + mx::GlslShaderGenerator::TARGET + "/lib/mx_transform_uv.glsl";
+	}
+
+	// Only the pattern part of the graph is emitted; the surface shader and
+	// its closures are replaced by Godot's own lighting.
+	for (const mx::ShaderNode *node : p_graph.getNodes()) {
+		if (node->hasClassification(mx::ShaderNode::Classification::TEXTURE)) {
+			emitFunctionDefinition(*node, p_context, p_stage);
+		}
+	}
+
+	setFunctionName("fragment", p_stage);
+	emitLine("void fragment()", p_stage, false);
+	emitFunctionBodyBegin(p_graph, p_context, p_stage);
+	_emit_private_uniforms(p_stage);
+	emitFunctionCalls(p_graph, p_context, p_stage, mx::ShaderNode::Classification::TEXTURE);
+	_emit_surface_outputs(p_graph, p_stage);
+	emitFunctionBodyEnd(p_graph, p_context, p_stage);
+}
+
+void MTLXGodotShaderGenerator::_emit_surface_outputs(const mx::ShaderGraph &p_graph, mx::ShaderStage &p_stage) const {
+	const mx::ShaderOutput *surface = p_graph.getOutputSocket()->getConnection();
+	if (!surface || !surface->getNode()->hasClassification(mx::ShaderNode::Classification::SURFACE)) {
+		return;
+	}
+	const mx::ShaderNode *node = surface->getNode();
+
+	auto expression = [&](const mx::ShaderInput *p_input) -> std::string {
+		const mx::ShaderOutput *upstream = p_input->getConnection();
+		if (upstream) {
+			return upstream->getVariable();
+		}
+		return p_input->getValue() ? _syntax->getValue(p_input->getType(), *p_input->getValue()) : _syntax->getDefaultValue(p_input->getType());
+	};
+
+	std::vector<std::string> written;
+	for (const MTLXSurfaceOutput &output : surface_outputs) {
+		const mx::ShaderInput *input = node->getInput(output.input);
+		if (!input || std::find(written.begin(), written.end(), output.builtin) != written.end()) {
+			continue;
+		}
+		written.push_back(output.builtin);
+		std::string value = resize_expression(expression(input), input->getType()->getSize(), output.size);
+
+		const mx::ShaderInput *weight = output.weight ? node->getInput(output.weight) : nullptr;
+		if (weight) {
+			value = "(" + value + ") * " + expression(weight);
+		}
+
+		if (std::string(output.builtin) == "NORMAL") {
+			// MaterialX normals are in world space, Godot's in view space.
+			value = "normalize((VIEW_MATRIX * vec4(" + value + ", 0.0)).xyz)";
+		} else if (std::string(output.builtin) == "ALPHA") {
+			// Writing ALPHA moves the material to the transparent pipeline, so
+			// only do it when the opacity isn't a constant 1.
+			const mx::ShaderOutput *upstream = input->getConnection();
+			mx::ValuePtr constant = upstream && upstream->getNode() == &p_graph ? upstream->getValue() : (!upstream ? input->getValue() : nullptr);
+			if (constant) {
+				bool opaque = false;
+				if (constant->isA<float>()) {
+					opaque = constant->asA<float>() >= 1.0f;
+				} else if (constant->isA<mx::Color3>()) {
+					mx::Color3 color = constant->asA<mx::Color3>();
+					opaque = color[0] >= 1.0f && color[1] >= 1.0f && color[2] >= 1.0f;
+				}
+				if (opaque) {
+					continue;
+				}
+			}
+		}
+		emitLine(std::string(output.builtin) + " = " + value, p_stage);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core/string/ustring.h"
+
+#include <MaterialXGenGlsl/GlslShaderGenerator.h>
+
+namespace mx = MaterialX;
+
+// Translates a MaterialX surface shader into Godot shading language, so
+// procedural graphs can be rendered by a ShaderMaterial without baking.
+//
+// Node implementations are the regular "genglsl" ones. The generator only
+// emits the pattern (texture) part of the graph and maps the inputs of the
+// surface shader node onto the spatial shader outputs (ALBEDO, ROUGHNESS...),
+// leaving lighting to Godot. The complete shader is the source code of the
+// pixel stage; the vertex stage is appended to it as the vertex() function.
+class MTLXGodotShaderGenerator : public mx::GlslShaderGenerator {
+public:
+	static mx::ShaderGeneratorPtr create() { return std::make_shared<MTLXGodotShaderGenerator>(); }
+	MTLXGodotShaderGenerator();
+
+	mx::ShaderPtr generate(const std::string &p_name, mx::ElementPtr p_element, mx::GenContext &p_context) const override;
+	const std::string getVertexDataPrefix(const mx::VariableBlock &p_vertex_data) const override;
+
+	// Godot shader code of a shader returned by generate().
+	static std::string get_source_code(const mx::ShaderPtr &p_shader);
+	// Compiles shader code with the engine's shader compiler, returning the
+	// first error, or an empty string when the code is valid.
+	static String validate_source_code(const String &p_code);
+
+protected:
+	void emitVertexStage(const mx::ShaderGraph &p_graph, mx::GenContext &p_context, mx::ShaderStage &p_stage) const override;
+	void emitPixelStage(const mx::ShaderGraph &p_graph, mx::GenContext &p_context, mx::ShaderStage &p_stage) const override;
+
+	void _emit_private_uniforms(mx::ShaderStage &p_stage) const;
+	void _emit_surface_outputs(const mx::ShaderGraph &p_graph, mx::ShaderStage &p_stage) const;
+};
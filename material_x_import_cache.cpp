@@ -0,0 +1,109 @@
+#include "material_x_import_cache.h"
+
+#include "core/io/config_file.h"
+#include "core/io/file_access.h"
+#include "core/io/resource_loader.h"
+#include "core/io/resource_saver.h"
+
+// Bump when the layout of cached resources or the composition of keys changes.
+static const int MTLX_IMPORT_CACHE_VERSION = 3;
+
+String MTLXImportCache::get_import_folder(const String &p_path) {
+	return "res://.godot/imported/" + p_path.get_file().get_basename() +
+			"-" + p_path.md5_text() + "/";
+}
+
+String MTLXImportCache::_get_manifest_path(const String &p_path) {
+	return get_import_folder(p_path) + "import_cache.cfg";
+}
+
+String MTLXImportCache::_get_resource_path(const String &p_path) {
+	return get_import_folder(p_path) + "material.res";
+}
+
+String MTLXImportCache::compute_key(const String &p_options, const Vector<String> &p_dependencies, HashMap<String, String> *r_md5_cache) {
+	String key = itos(MTLX_IMPORT_CACHE_VERSION) + "|" + p_options;
+	for (int i = 0; i < p_dependencies.size(); i++) {
+		const String &path = p_dependencies[i];
+		String md5;
+		if (r_md5_cache && r_md5_cache->has(path)) {
+			md5 = (*r_md5_cache)[path];
+		} else {
+			// A missing file hashes to an empty string, which never matches a stored key.
+			md5 = FileAccess::get_md5(path);
+			if (r_md5_cache) {
+				(*r_md5_cache)[path] = md5;
+			}
+		}
+		key += "|" + path + ":" + md5;
+	}
+	return key.sha256_text();
+}
+
+String MTLXImportCache::get_resource_type(const String &p_path) {
+	Ref<ConfigFile> manifest;
+	manifest.instantiate();
+	if (manifest->load(_get_manifest_path(p_path)) != OK) {
+		return String();
+	}
+	return manifest->get_value("import", "type", String());
+}
+
+RES MTLXImportCache::load(const String &p_path, const String &p_options) {
+	String resource_path = _get_resource_path(p_path);
+	if (!FileAccess::exists(resource_path)) {
+		return RES();
+	}
+	Ref<ConfigFile> manifest;
+	manifest.instantiate();
+	if (manifest->load(_get_manifest_path(p_path)) != OK) {
+		return RES();
+	}
+	Vector<String> dependencies = manifest->get_value("import", "dependencies", PackedStringArray());
+	String key = manifest->get_value("import", "key", String());
+	if (key.is_empty() || key != compute_key(p_options, dependencies)) {
+		return RES();
+	}
+	print_verbose(vformat("MaterialX import cache hit for %s", p_path));
+	return ResourceLoader::load(resource_path, "", ResourceFormatLoader::CACHE_MODE_IGNORE);
+}
+
+RES MTLXImportCache::load_previous(const String &p_path) {
+	String resource_path = _get_resource_path(p_path);
+	if (!FileAccess::exists(resource_path)) {
+		return RES();
+	}
+	return ResourceLoader::load(resource_path, "", ResourceFormatLoader::CACHE_MODE_IGNORE);
+}
+
+Dictionary MTLXImportCache::get_material_keys(const String &p_path) {
+	Ref<ConfigFile> manifest;
+	manifest.instantiate();
+	if (manifest->load(_get_manifest_path(p_path)) != OK || !manifest->has_section("materials")) {
+		return Dictionary();
+	}
+	Dictionary keys;
+	List<String> names;
+	manifest->get_section_keys("materials", &names);
+	for (const String &name : names) {
+		keys[name] = manifest->get_value("materials", name);
+	}
+	return keys;
+}
+
+Error MTLXImportCache::save(const String &p_path, const String &p_options, const Vector<String> &p_dependencies, const RES &p_resource, const Dictionary &p_material_keys) {
+	ERR_FAIL_COND_V(p_resource.is_null(), ERR_INVALID_PARAMETER);
+	Error err = ResourceSaver::save(_get_resource_path(p_path), p_resource);
+	ERR_FAIL_COND_V_MSG(err != OK, err, vformat("Can't write MaterialX import cache for %s", p_path));
+
+	Ref<ConfigFile> manifest;
+	manifest.instantiate();
+	manifest->set_value("import", "key", compute_key(p_options, p_dependencies));
+	manifest->set_value("import", "type", p_resource->get_class());
+	manifest->set_value("import", "dependencies", PackedStringArray(p_dependencies));
+	Array names = p_material_keys.keys();
+	for (int i = 0; i < names.size(); i++) {
+		manifest->set_value("materials", names[i], p_material_keys[names[i]]);
+	}
+	return manifest->save(_get_manifest_path(p_path));
+}
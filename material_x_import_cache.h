@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core/io/resource.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/vector.h"
+#include "core/variant/dictionary.h"
+
+// Persistent cache of finished MaterialX imports.
+// Each entry is keyed by the content of the source document, every file it
+// depends on (xincludes, referenced textures and the library files defining
+// its nodes) and the bake options. A hit loads the stored binary resource
+// without touching MaterialX at all. Textures are saved on their own by the
+// loader, so stored materials reference them by path rather than embed them.
+//
+// The manifest also records a key per material, so that after a change the
+// materials whose own dependencies are untouched can be taken from the
+// previous result instead of being baked again.
+class MTLXImportCache {
+	static String _get_manifest_path(const String &p_path);
+	static String _get_resource_path(const String &p_path);
+
+public:
+	// Hashes the options with the content of every dependency. Pass a cache
+	// to hash files shared by several keys only once.
+	static String compute_key(const String &p_options, const Vector<String> &p_dependencies, HashMap<String, String> *r_md5_cache = nullptr);
+
+	static String get_import_folder(const String &p_path);
+	static String get_resource_type(const String &p_path);
+	static RES load(const String &p_path, const String &p_options);
+	// The last stored result and its material keys, whether or not still up to date.
+	static RES load_previous(const String &p_path);
+	static Dictionary get_material_keys(const String &p_path);
+	static Error save(const String &p_path, const String &p_options, const Vector<String> &p_dependencies, const RES &p_resource, const Dictionary &p_material_keys = Dictionary());
+};
@@ -0,0 +1,74 @@
+#include "material_x_library.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/file_access.h"
+#include "core/os/os.h"
+#include "core/templates/hashfuncs.h"
+
+#include <MaterialXFormat/Util.h>
+
+Mutex MTLXLibrary::mutex;
+mx::DocumentPtr MTLXLibrary::document;
+uint64_t MTLXLibrary::fingerprint = 0;
+
+mx::FilePath MTLXLibrary::get_library_folder() {
+	return ProjectSettings::get_singleton()->globalize_path("res://libraries").utf8().get_data();
+}
+
+uint64_t MTLXLibrary::_compute_fingerprint(const mx::FilePath &p_folder) {
+	// Implementation sources are part of the generated shaders and baked
+	// images, so edits to them must change the fingerprint too.
+	const std::string extensions[] = { mx::MTLX_EXTENSION, "glsl" };
+
+	uint64_t hash = hash_djb2_one_64(String(p_folder.asString().c_str()).hash64());
+	for (const mx::FilePath &dir : p_folder.getSubDirectories()) {
+		for (const std::string &extension : extensions) {
+			for (const mx::FilePath &file : dir.getFilesInDirectory(extension)) {
+				String path = String((dir / file).asString().c_str());
+				hash = hash_djb2_one_64(path.hash64(), hash);
+				hash = hash_djb2_one_64(FileAccess::get_modified_time(path), hash);
+			}
+		}
+	}
+	return hash;
+}
+
+uint64_t MTLXLibrary::get_fingerprint() {
+	// Reuse the scan of the last get(), which every import makes first.
+	MutexLock lock(mutex);
+	return document ? fingerprint : _compute_fingerprint(get_library_folder());
+}
+
+mx::DocumentPtr MTLXLibrary::get(const mx::FileSearchPath &p_search_path, MTLXProfiler::Stats *p_stats) {
+	mx::FilePath folder = get_library_folder();
+	uint64_t current = _compute_fingerprint(folder);
+
+	MutexLock lock(mutex);
+	MTLXProfiler::add_cache_access(MTLXProfiler::CACHE_LIBRARY, document && current == fingerprint, p_stats);
+	if (document && current == fingerprint) {
+		return document;
+	}
+
+	MTLXProfiler::Scope scope(MTLXProfiler::PHASE_LIBRARY_LOAD, p_stats);
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	mx::DocumentPtr lib = mx::createDocument();
+	mx::FilePathVec libraryFolders;
+	libraryFolders.push_back(folder);
+	mx::StringSet libraryFiles = mx::loadLibraries(libraryFolders, p_search_path, lib);
+	if (libraryFiles.empty()) {
+		ERR_PRINT(vformat("Could not find standard data libraries on the given search path: %s", String(p_search_path.asString().c_str())));
+		return mx::DocumentPtr();
+	}
+	// Build the lookup indices once; edits from here on throw.
+	lib->freeze();
+	document = lib;
+	fingerprint = current;
+	print_verbose(vformat("MaterialX loaded %d library files in %d ms", (int64_t)libraryFiles.size(), (OS::get_singleton()->get_ticks_usec() - begin) / 1000));
+	return document;
+}
+
+void MTLXLibrary::clear() {
+	MutexLock lock(mutex);
+	document.reset();
+	fingerprint = 0;
+}
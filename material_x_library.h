@@ -0,0 +1,30 @@
+#pragma once
+
+#include "material_x_profiler.h"
+
+#include "core/os/mutex.h"
+
+#include <MaterialXCore/Document.h>
+#include <MaterialXFormat/File.h>
+
+namespace mx = MaterialX;
+
+// Process-wide copy of the MaterialX data libraries in res://libraries.
+// The document is loaded once and frozen, so it is shared by every import and
+// every loader thread, which look definitions up in it without locking. It is
+// reloaded only when the set of library files or implementation sources, or
+// their modification times, change. The folder is scanned once per get(); the
+// fingerprint of that scan keys the shader and bake caches.
+class MTLXLibrary {
+	static Mutex mutex;
+	static mx::DocumentPtr document;
+	static uint64_t fingerprint;
+
+	static uint64_t _compute_fingerprint(const mx::FilePath &p_folder);
+
+public:
+	static mx::FilePath get_library_folder();
+	static uint64_t get_fingerprint();
+	static mx::DocumentPtr get(const mx::FileSearchPath &p_search_path, MTLXProfiler::Stats *p_stats = nullptr);
+	static void clear();
+};
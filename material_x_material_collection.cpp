@@ -0,0 +1,40 @@
+#include "material_x_material_collection.h"
+
+void MTLXMaterialCollection::set_materials(const Dictionary &p_materials) {
+	materials = p_materials;
+}
+
+Dictionary MTLXMaterialCollection::get_materials() const {
+	return materials;
+}
+
+void MTLXMaterialCollection::add_material(const String &p_name, const Ref<Material> &p_material) {
+	materials[p_name] = p_material;
+}
+
+Ref<Material> MTLXMaterialCollection::get_material(const String &p_name) const {
+	return materials.get(p_name, Ref<Material>());
+}
+
+PackedStringArray MTLXMaterialCollection::get_material_names() const {
+	PackedStringArray names;
+	Array keys = materials.keys();
+	for (int i = 0; i < keys.size(); i++) {
+		names.push_back(keys[i]);
+	}
+	return names;
+}
+
+int MTLXMaterialCollection::get_material_count() const {
+	return materials.size();
+}
+
+void MTLXMaterialCollection::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_materials", "materials"), &MTLXMaterialCollection::set_materials);
+	ClassDB::bind_method(D_METHOD("get_materials"), &MTLXMaterialCollection::get_materials);
+	ClassDB::bind_method(D_METHOD("get_material", "name"), &MTLXMaterialCollection::get_material);
+	ClassDB::bind_method(D_METHOD("get_material_names"), &MTLXMaterialCollection::get_material_names);
+	ClassDB::bind_method(D_METHOD("get_material_count"), &MTLXMaterialCollection::get_material_count);
+
+	ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "materials"), "set_materials", "get_materials");
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "core/io/resource.h"
+#include "scene/resources/material.h"
+
+// All materials of a multi-material .mtlx document, keyed by material name in
+// document order. Documents with a single material load as that material.
+class MTLXMaterialCollection : public Resource {
+	GDCLASS(MTLXMaterialCollection, Resource);
+
+	Dictionary materials;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_materials(const Dictionary &p_materials);
+	Dictionary get_materials() const;
+
+	void add_material(const String &p_name, const Ref<Material> &p_material);
+	Ref<Material> get_material(const String &p_name) const;
+	PackedStringArray get_material_names() const;
+	int get_material_count() const;
+};
@@ -0,0 +1,137 @@
+#include "material_x_profiler.h"
+
+#include "core/object/callable_method_pointer.h"
+#include "main/performance.h"
+
+static const char *phase_names[MTLXProfiler::PHASE_MAX] = {
+	"Import",
+	"Library load",
+	"Library import",
+	"XML parse",
+	"Validate",
+	"Shader generation",
+	"Bake render",
+	"Image write",
+	"Texture decode",
+	"Mipmap generation",
+	"Compression",
+};
+
+static const char *cache_names[MTLXProfiler::CACHE_MAX] = {
+	"Import cache",
+	"Library cache",
+	"Texture cache",
+	"Compressed image cache",
+	"Shader cache",
+	"Bake cache",
+};
+
+Mutex MTLXProfiler::mutex;
+MTLXProfiler::Stats MTLXProfiler::totals;
+MTLXProfiler *MTLXProfiler::singleton = nullptr;
+
+void MTLXProfiler::Scope::end() {
+	if (ended) {
+		return;
+	}
+	ended = true;
+	timer.endTimer();
+	add_time(phase, seconds, stats);
+}
+
+void MTLXProfiler::add_time(Phase p_phase, double p_seconds, Stats *p_stats, uint64_t p_count) {
+	ERR_FAIL_INDEX(p_phase, PHASE_MAX);
+	uint64_t usec = uint64_t(p_seconds * 1000000.0);
+	totals.usec[p_phase].add(usec);
+	totals.count[p_phase].add(p_count);
+	if (p_stats) {
+		p_stats->usec[p_phase].add(usec);
+		p_stats->count[p_phase].add(p_count);
+	}
+}
+
+void MTLXProfiler::add_cache_access(Cache p_cache, bool p_hit, Stats *p_stats) {
+	ERR_FAIL_INDEX(p_cache, CACHE_MAX);
+	(p_hit ? totals.hits : totals.misses)[p_cache].increment();
+	if (p_stats) {
+		(p_hit ? p_stats->hits : p_stats->misses)[p_cache].increment();
+	}
+}
+
+String MTLXProfiler::get_summary(const Stats &p_stats) {
+	String summary;
+	for (int i = 0; i < PHASE_MAX; i++) {
+		uint64_t count = p_stats.count[i].get();
+		if (!count) {
+			continue;
+		}
+		summary += vformat("%s%s %.1f ms", summary.is_empty() ? "" : ", ", phase_names[i], p_stats.usec[i].get() / 1000.0);
+		if (count > 1) {
+			summary += vformat(" (%d)", count);
+		}
+	}
+	for (int i = 0; i < CACHE_MAX; i++) {
+		uint64_t hits = p_stats.hits[i].get();
+		uint64_t accesses = hits + p_stats.misses[i].get();
+		if (accesses) {
+			summary += vformat("%s%s %d/%d hits", summary.is_empty() ? "" : ", ", String(cache_names[i]).to_lower(), hits, accesses);
+		}
+	}
+	return summary;
+}
+
+double MTLXProfiler::_get_phase_time(int p_phase) const {
+	ERR_FAIL_INDEX_V(p_phase, PHASE_MAX, 0.0);
+	return totals.usec[p_phase].get() / 1000.0;
+}
+
+uint64_t MTLXProfiler::_get_phase_count(int p_phase) const {
+	ERR_FAIL_INDEX_V(p_phase, PHASE_MAX, 0);
+	return totals.count[p_phase].get();
+}
+
+double MTLXProfiler::_get_cache_hit_rate(int p_cache) const {
+	ERR_FAIL_INDEX_V(p_cache, CACHE_MAX, 0.0);
+	uint64_t hits = totals.hits[p_cache].get();
+	uint64_t accesses = hits + totals.misses[p_cache].get();
+	return accesses ? 100.0 * hits / accesses : 0.0;
+}
+
+void MTLXProfiler::register_monitors() {
+	MutexLock lock(mutex);
+	Performance *performance = Performance::get_singleton();
+	if (singleton || !performance) {
+		return;
+	}
+	singleton = memnew(MTLXProfiler);
+	for (int i = 0; i < PHASE_MAX; i++) {
+		Vector<Variant> args;
+		args.push_back(i);
+		performance->add_custom_monitor(vformat("MaterialX/%s (ms)", phase_names[i]), callable_mp(singleton, &MTLXProfiler::_get_phase_time), args);
+		performance->add_custom_monitor(vformat("MaterialX/%s count", phase_names[i]), callable_mp(singleton, &MTLXProfiler::_get_phase_count), args);
+	}
+	for (int i = 0; i < CACHE_MAX; i++) {
+		Vector<Variant> args;
+		args.push_back(i);
+		performance->add_custom_monitor(vformat("MaterialX/%s hit rate (%%)", cache_names[i]), callable_mp(singleton, &MTLXProfiler::_get_cache_hit_rate), args);
+	}
+}
+
+void MTLXProfiler::unregister_monitors() {
+	MutexLock lock(mutex);
+	if (!singleton) {
+		return;
+	}
+	Performance *performance = Performance::get_singleton();
+	if (performance) {
+		for (int i = 0; i < PHASE_MAX; i++) {
+			performance->remove_custom_monitor(vformat("MaterialX/%s (ms)", phase_names[i]));
+			performance->remove_custom_monitor(vformat("MaterialX/%s count", phase_names[i]));
+		}
+		for (int i = 0; i < CACHE_MAX; i++) {
+			performance->remove_custom_monitor(vformat("MaterialX/%s hit rate (%%)", cache_names[i]));
+		}
+	}
+	memdelete(singleton);
+	singleton = nullptr;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/object/object.h"
+#include "core/os/mutex.h"
+#include "core/templates/safe_refcount.h"
+
+#include <MaterialXRender/Timer.h>
+
+namespace mx = MaterialX;
+
+// Cumulative timings of the MaterialX import phases and hit counts of the
+// importer's caches, published as custom Performance monitors under
+// "MaterialX/". Everything recorded for an import is also added to its own
+// Stats, which the loader prints as a summary in verbose mode.
+class MTLXProfiler : public Object {
+	GDCLASS(MTLXProfiler, Object);
+
+public:
+	enum Phase {
+		PHASE_IMPORT,
+		PHASE_LIBRARY_LOAD,
+		PHASE_LIBRARY_IMPORT,
+		PHASE_XML_PARSE,
+		PHASE_VALIDATE,
+		PHASE_SHADER_GENERATE,
+		PHASE_BAKE_RENDER,
+		PHASE_IMAGE_WRITE,
+		PHASE_TEXTURE_DECODE,
+		PHASE_MIPMAP,
+		PHASE_COMPRESS,
+		PHASE_MAX,
+	};
+
+	enum Cache {
+		CACHE_IMPORT,
+		CACHE_LIBRARY,
+		CACHE_TEXTURE,
+		CACHE_COMPRESSED_IMAGE,
+		CACHE_SHADER,
+		CACHE_BAKE,
+		CACHE_MAX,
+	};
+
+	// Counters of one import, or of all of them. Safe to update from the
+	// texture decoding threads.
+	struct Stats {
+		SafeNumeric<uint64_t> usec[PHASE_MAX];
+		SafeNumeric<uint64_t> count[PHASE_MAX];
+		SafeNumeric<uint64_t> hits[CACHE_MAX];
+		SafeNumeric<uint64_t> misses[CACHE_MAX];
+	};
+
+	// Times a phase with mx::ScopedTimer until end() or the end of the scope.
+	class Scope {
+		Phase phase;
+		Stats *stats = nullptr;
+		double seconds = 0.0;
+		bool ended = false;
+		mx::ScopedTimer timer;
+
+	public:
+		void end();
+
+		Scope(Phase p_phase, Stats *p_stats = nullptr) :
+				phase(p_phase), stats(p_stats), timer(&seconds) {}
+		~Scope() { end(); }
+	};
+
+private:
+	static Mutex mutex;
+	static Stats totals;
+	static MTLXProfiler *singleton;
+
+	double _get_phase_time(int p_phase) const;
+	uint64_t _get_phase_count(int p_phase) const;
+	double _get_cache_hit_rate(int p_cache) const;
+
+public:
+	static void add_time(Phase p_phase, double p_seconds, Stats *p_stats = nullptr, uint64_t p_count = 1);
+	static void add_cache_access(Cache p_cache, bool p_hit, Stats *p_stats = nullptr);
+	static const Stats &get_totals() { return totals; }
+	static String get_summary(const Stats &p_stats);
+
+	// Performance is created after the modules, so monitors are added on the
+	// first import.
+	static void register_monitors();
+	static void unregister_monitors();
+};
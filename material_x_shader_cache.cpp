@@ -0,0 +1,151 @@
+#include "material_x_shader_cache.h"
+#include "material_x_library.h"
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/io/resource_loader.h"
+#include "core/io/resource_saver.h"
+
+#include <MaterialXGenShader/HwShaderGenerator.h>
+
+#include <map>
+
+static const char *MTLX_SHADER_FOLDER = "res://.godot/imported/materialx_shaders/";
+
+Mutex MTLXShaderCache::mutex;
+HashMap<String, MTLXShaderCache::Entry> MTLXShaderCache::entries;
+
+namespace {
+
+// Types of the values the generator exposes as uniforms.
+bool is_uniform_type(const std::string &p_type) {
+	static const char *types[] = { "float", "integer", "boolean", "color3", "color4", "vector2", "vector3", "vector4", "filename" };
+	for (const char *type : types) {
+		if (p_type == type) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Serializes an element and everything upstream of it, naming elements by
+// visiting order so that the names given in the document don't matter.
+int visit_element(const mx::ElementPtr &p_elem, std::map<mx::ElementPtr, int> &r_ids, std::vector<mx::InputPtr> &r_inputs, std::string &r_content) {
+	if (!p_elem) {
+		return -1;
+	}
+	auto found = r_ids.find(p_elem);
+	if (found != r_ids.end()) {
+		return found->second;
+	}
+	int id = (int)r_ids.size();
+	r_ids[p_elem] = id;
+
+	std::string line = std::to_string(id) + " " + p_elem->getCategory();
+	if (mx::TypedElementPtr typed = p_elem->asA<mx::TypedElement>()) {
+		line += " " + typed->getType();
+	}
+	if (mx::InputPtr input = p_elem->asA<mx::Input>()) {
+		r_inputs.push_back(input);
+		line += " " + input->getName() + " " + input->getActiveColorSpace() + " " + input->getUnit() + " " + input->getUnitType() + " " + input->getOutputString();
+		if (!is_uniform_type(input->getType())) {
+			line += " " + input->getValueString();
+		}
+		line += " " + std::to_string(visit_element(input->getInterfaceInput(), r_ids, r_inputs, r_content));
+		line += " " + std::to_string(visit_element(input->getConnectedOutput(), r_ids, r_inputs, r_content));
+		line += " " + std::to_string(visit_element(input->getConnectedNode(), r_ids, r_inputs, r_content));
+	} else if (mx::OutputPtr output = p_elem->asA<mx::Output>()) {
+		line += " " + output->getName() + " " + output->getOutputString();
+		line += " " + std::to_string(visit_element(output->getConnectedNode(), r_ids, r_inputs, r_content));
+		mx::InterfaceElementPtr graph = output->getParent()->asA<mx::InterfaceElement>();
+		if (graph && output->hasInterfaceName()) {
+			line += " " + std::to_string(visit_element(graph->getInput(output->getInterfaceName()), r_ids, r_inputs, r_content));
+		}
+	} else if (mx::NodePtr node = p_elem->asA<mx::Node>()) {
+		mx::NodeDefPtr node_def = node->getNodeDef();
+		line += " " + (node_def ? node_def->getName() : std::string());
+		for (const mx::ElementPtr &child : node->getChildren()) {
+			line += " " + std::to_string(visit_element(child, r_ids, r_inputs, r_content));
+		}
+	}
+	r_content += line + "\n";
+	return id;
+}
+
+} // namespace
+
+String MTLXShaderCache::hash_topology(const mx::NodePtr &p_shader_node, std::vector<mx::InputPtr> &r_inputs) {
+	std::map<mx::ElementPtr, int> ids;
+	std::string content = std::to_string(MTLXLibrary::get_fingerprint()) + "\n";
+	visit_element(p_shader_node, ids, r_inputs, content);
+	return String(content.c_str()).sha256_text();
+}
+
+bool MTLXShaderCache::get(const String &p_hash, Entry &r_entry) {
+	MutexLock lock(mutex);
+	const Entry *entry = entries.getptr(p_hash);
+	if (!entry) {
+		return false;
+	}
+	r_entry = *entry;
+	return true;
+}
+
+MTLXShaderCache::Entry MTLXShaderCache::add(const String &p_hash, const mx::ShaderPtr &p_shader, const String &p_code, const std::vector<mx::InputPtr> &p_inputs) {
+	std::map<std::string, int> input_indices;
+	for (size_t i = 0; i < p_inputs.size(); i++) {
+		input_indices[p_inputs[i]->getNamePath()] = (int)i;
+	}
+
+	Entry entry;
+	std::vector<bool> driven(p_inputs.size(), false);
+	const mx::VariableBlock &uniforms = p_shader->getStage(mx::Stage::PIXEL).getUniformBlock(mx::HW::PUBLIC_UNIFORMS);
+	for (size_t i = 0; i < uniforms.size(); i++) {
+		auto found = input_indices.find(uniforms[i]->getPath());
+		if (found == input_indices.end()) {
+			continue;
+		}
+		Uniform uniform;
+		uniform.variable = uniforms[i]->getVariable().c_str();
+		uniform.input_index = found->second;
+		uniform.type = uniforms[i]->getType()->getName();
+		entry.uniforms.push_back(uniform);
+		driven[found->second] = true;
+		mx::InputPtr interface_input = p_inputs[found->second]->getInterfaceInput();
+		if (interface_input && input_indices.count(interface_input->getNamePath())) {
+			driven[input_indices[interface_input->getNamePath()]] = true;
+		}
+	}
+	// Values compiled into the code can't vary per material.
+	bool shareable = true;
+	for (size_t i = 0; i < p_inputs.size() && shareable; i++) {
+		const mx::InputPtr &input = p_inputs[i];
+		shareable = driven[i] || !input->hasValue() || !is_uniform_type(input->getType());
+	}
+
+	String path = MTLX_SHADER_FOLDER + p_hash + ".gdshader";
+	if (shareable && FileAccess::exists(path)) {
+		entry.shader = ResourceLoader::load(path, "Shader");
+	}
+	if (entry.shader.is_null() || entry.shader->get_code() != p_code) {
+		entry.shader.instantiate();
+		entry.shader->set_code(p_code);
+		if (shareable) {
+			DirAccessRef dir = DirAccess::create(DirAccess::ACCESS_RESOURCES);
+			dir->make_dir_recursive(MTLX_SHADER_FOLDER);
+			if (ResourceSaver::save(path, entry.shader, ResourceSaver::FLAG_CHANGE_PATH) != OK) {
+				ERR_PRINT(vformat("Can't write MaterialX shader %s", path));
+			}
+		}
+	}
+	if (shareable) {
+		MutexLock lock(mutex);
+		entries[p_hash] = entry;
+	}
+	return entry;
+}
+
+void MTLXShaderCache::clear() {
+	MutexLock lock(mutex);
+	entries.clear();
+}
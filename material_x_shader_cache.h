@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/vector.h"
+#include "scene/resources/shader.h"
+
+#include <MaterialXCore/Node.h>
+#include <MaterialXGenShader/Shader.h>
+
+namespace mx = MaterialX;
+
+// Godot shaders generated from MaterialX graphs, shared by every material whose
+// graph has the same topology. Graphs are hashed without the constant values
+// and file names the generator turns into uniforms; a material reusing a
+// shader sets those uniforms from its own inputs instead. Shaders are saved
+// under the imported folder, so materials of different imports reference a
+// single resource and Godot compiles it once.
+class MTLXShaderCache {
+public:
+	struct Uniform {
+		String variable;
+		// Index of the input driving the uniform, in the order of hash_topology().
+		int input_index = -1;
+		std::string type;
+	};
+
+	struct Entry {
+		Ref<Shader> shader;
+		Vector<Uniform> uniforms;
+	};
+
+private:
+	static Mutex mutex;
+	static HashMap<String, Entry> entries;
+
+public:
+	// Hashes the graph upstream of a shader node, listing the inputs visited in
+	// r_inputs. Graphs with the same hash generate the same code.
+	static String hash_topology(const mx::NodePtr &p_shader_node, std::vector<mx::InputPtr> &r_inputs);
+
+	static bool get(const String &p_hash, Entry &r_entry);
+	// Stores the shader generated for a graph. It is only shared when all the
+	// values of the graph reach the shader as uniforms.
+	static Entry add(const String &p_hash, const mx::ShaderPtr &p_shader, const String &p_code, const std::vector<mx::InputPtr> &p_inputs);
+	static void clear();
+};
@@ -0,0 +1,76 @@
+#include "material_x_texture_cache.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/file_access.h"
+
+Mutex MTLXTextureCache::mutex;
+HashMap<String, MTLXTextureCache::Entry> MTLXTextureCache::entries;
+List<String> MTLXTextureCache::lru;
+uint64_t MTLXTextureCache::total_size = 0;
+
+uint64_t MTLXTextureCache::get_budget() {
+	return uint64_t(int64_t(GLOBAL_GET("material_x/texture_cache/budget_mb"))) * 1024 * 1024;
+}
+
+void MTLXTextureCache::_erase(const String &p_key) {
+	Entry *entry = entries.getptr(p_key);
+	if (!entry) {
+		return;
+	}
+	total_size -= entry->size;
+	lru.erase(entry->lru);
+	entries.erase(p_key);
+}
+
+void MTLXTextureCache::_evict(uint64_t p_budget) {
+	while (total_size > p_budget && lru.size()) {
+		_erase(lru.front()->get());
+	}
+}
+
+String MTLXTextureCache::get_key(const String &p_path, const String &p_variant) {
+	return p_variant.is_empty() ? p_path : p_path + "|" + p_variant;
+}
+
+Ref<Texture2D> MTLXTextureCache::get(const String &p_path, const String &p_variant) {
+	uint64_t modified_time = FileAccess::get_modified_time(p_path);
+	String key = get_key(p_path, p_variant);
+	MutexLock lock(mutex);
+	Entry *entry = entries.getptr(key);
+	if (!entry) {
+		return Ref<Texture2D>();
+	}
+	if (entry->modified_time != modified_time) {
+		_erase(key);
+		return Ref<Texture2D>();
+	}
+	lru.move_to_back(entry->lru);
+	return entry->texture;
+}
+
+void MTLXTextureCache::add(const String &p_path, const String &p_variant, const Ref<Texture2D> &p_texture, uint64_t p_size) {
+	ERR_FAIL_COND(p_texture.is_null());
+	uint64_t modified_time = FileAccess::get_modified_time(p_path);
+	String key = get_key(p_path, p_variant);
+	uint64_t budget = get_budget();
+	MutexLock lock(mutex);
+	_erase(key);
+	if (p_size > budget) {
+		return;
+	}
+	Entry entry;
+	entry.texture = p_texture;
+	entry.modified_time = modified_time;
+	entry.size = p_size;
+	entry.lru = lru.push_back(key);
+	entries[key] = entry;
+	total_size += p_size;
+	_evict(budget);
+}
+
+void MTLXTextureCache::clear() {
+	MutexLock lock(mutex);
+	entries.clear();
+	lru.clear();
+	total_size = 0;
+}
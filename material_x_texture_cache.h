@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/list.h"
+#include "scene/resources/texture.h"
+
+// Textures decoded by the MaterialX importer, shared across materials and loads.
+// Entries are keyed by resolved path and by the variant the image was decoded
+// to, and invalidated when the file's modification time changes. The least recently used entries are dropped once
+// the total size exceeds the configured budget.
+class MTLXTextureCache {
+	struct Entry {
+		Ref<Texture2D> texture;
+		uint64_t modified_time = 0;
+		uint64_t size = 0;
+		List<String>::Element *lru = nullptr;
+	};
+
+	static Mutex mutex;
+	static HashMap<String, Entry> entries;
+	static List<String> lru;
+	static uint64_t total_size;
+
+	static void _erase(const String &p_key);
+	static void _evict(uint64_t p_budget);
+
+public:
+	static uint64_t get_budget();
+	static String get_key(const String &p_path, const String &p_variant);
+	static Ref<Texture2D> get(const String &p_path, const String &p_variant);
+	static void add(const String &p_path, const String &p_variant, const Ref<Texture2D> &p_texture, uint64_t p_size);
+	static void clear();
+};
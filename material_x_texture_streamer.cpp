@@ -0,0 +1,200 @@
+#include "material_x_texture_streamer.h"
+
+#include "material_x_material_collection.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/resource_loader.h"
+#include "core/object/callable_method_pointer.h"
+#include "core/object/message_queue.h"
+
+Mutex MTLXTextureStreamer::mutex;
+Semaphore MTLXTextureStreamer::semaphore;
+List<MTLXTextureStreamer::Request> MTLXTextureStreamer::queue;
+List<MTLXTextureStreamer::Request> MTLXTextureStreamer::resident;
+uint64_t MTLXTextureStreamer::resident_size = 0;
+Vector<Thread *> MTLXTextureStreamer::threads;
+SafeFlag MTLXTextureStreamer::exit;
+MTLXTextureStreamer *MTLXTextureStreamer::singleton = nullptr;
+
+static const char *MTLX_STREAM_PATH_META = "mtlx_stream_path";
+
+bool MTLXTextureStreamer::is_enabled() {
+	return GLOBAL_GET("material_x/streaming/enabled");
+}
+
+uint64_t MTLXTextureStreamer::get_budget() {
+	return uint64_t(int64_t(GLOBAL_GET("material_x/streaming/budget_mb"))) * 1024 * 1024;
+}
+
+String MTLXTextureStreamer::get_preview_path(const String &p_image_path) {
+	return p_image_path.get_basename() + ".preview.res";
+}
+
+Ref<Image> MTLXTextureStreamer::create_preview(const Ref<Image> &p_image) {
+	ERR_FAIL_COND_V(p_image.is_null(), Ref<Image>());
+	int preview_size = GLOBAL_GET("material_x/streaming/preview_size");
+	if (!p_image->has_mipmaps() || MAX(p_image->get_width(), p_image->get_height()) <= preview_size) {
+		return Ref<Image>();
+	}
+	for (int i = 1; i <= p_image->get_mipmap_count(); i++) {
+		int offset, size, width, height;
+		p_image->get_mipmap_offset_size_and_dimensions(i, offset, size, width, height);
+		if (MAX(width, height) > preview_size) {
+			continue;
+		}
+		// The tail of a mip chain is the full mip chain of its first level.
+		Vector<uint8_t> data = p_image->get_data();
+		Vector<uint8_t> mips = data.subarray(offset, data.size() - 1);
+		ERR_FAIL_COND_V(mips.size() != Image::get_image_data_size(width, height, p_image->get_format(), true), Ref<Image>());
+		Ref<Image> preview;
+		preview.instantiate();
+		preview->create(width, height, true, p_image->get_format(), mips);
+		return preview;
+	}
+	return Ref<Image>();
+}
+
+void MTLXTextureStreamer::_swap_image(uint64_t p_texture, const Ref<Image> &p_image) {
+	ImageTexture *texture = Object::cast_to<ImageTexture>(ObjectDB::get_instance(ObjectID(p_texture)));
+	if (texture) {
+		texture->create_from_image(p_image);
+		return;
+	}
+	// Freed since; give its share of the budget back.
+	MutexLock lock(mutex);
+	for (List<Request>::Element *E = resident.front(); E; E = E->next()) {
+		if (E->get().texture == ObjectID(p_texture)) {
+			resident_size -= E->get().size;
+			resident.erase(E);
+			break;
+		}
+	}
+}
+
+void MTLXTextureStreamer::_stream(Request &p_request) {
+	Ref<Image> image = ResourceLoader::load(p_request.path, "Image", ResourceFormatLoader::CACHE_MODE_IGNORE);
+	if (image.is_null()) {
+		print_verbose(vformat("MaterialX can't stream %s", p_request.path));
+		return;
+	}
+	p_request.size = image->get_data().size();
+	uint64_t budget = get_budget();
+	if (p_request.size > budget) {
+		return;
+	}
+	MutexLock lock(mutex);
+	while (resident_size + p_request.size > budget && resident.size()) {
+		const Request &oldest = resident.front()->get();
+		MessageQueue::get_singleton()->push_callable(callable_mp(singleton, &MTLXTextureStreamer::_swap_image), uint64_t(oldest.texture), oldest.preview);
+		resident_size -= oldest.size;
+		resident.pop_front();
+	}
+	resident_size += p_request.size;
+	resident.push_back(p_request);
+	MessageQueue::get_singleton()->push_callable(callable_mp(singleton, &MTLXTextureStreamer::_swap_image), uint64_t(p_request.texture), image);
+}
+
+void MTLXTextureStreamer::_thread_func(void *p_user) {
+	while (true) {
+		semaphore.wait();
+		if (exit.is_set()) {
+			return;
+		}
+		Request request;
+		{
+			MutexLock lock(mutex);
+			if (queue.is_empty()) {
+				continue;
+			}
+			request = queue.front()->get();
+			queue.pop_front();
+		}
+		_stream(request);
+	}
+}
+
+void MTLXTextureStreamer::request(const Ref<ImageTexture> &p_texture, const String &p_image_path, const Ref<Image> &p_preview) {
+	ERR_FAIL_COND(p_texture.is_null());
+	MutexLock lock(mutex);
+	if (!singleton) {
+		singleton = memnew(MTLXTextureStreamer);
+		exit.clear();
+		int thread_count = MAX(int(GLOBAL_GET("material_x/streaming/threads")), 1);
+		for (int i = 0; i < thread_count; i++) {
+			Thread *thread = memnew(Thread);
+			thread->start(&MTLXTextureStreamer::_thread_func, nullptr);
+			threads.push_back(thread);
+		}
+	}
+	p_texture->set_meta(MTLX_STREAM_PATH_META, p_image_path);
+	Request request;
+	request.texture = p_texture->get_instance_id();
+	request.path = p_image_path;
+	request.preview = p_preview;
+	queue.push_back(request);
+	semaphore.post();
+}
+
+void MTLXTextureStreamer::resume(const RES &p_resource, bool p_stream) {
+	Vector<Ref<Material>> materials;
+	Ref<MTLXMaterialCollection> collection = p_resource;
+	if (collection.is_valid()) {
+		PackedStringArray names = collection->get_material_names();
+		for (int i = 0; i < names.size(); i++) {
+			materials.push_back(collection->get_material(names[i]));
+		}
+	} else if (Ref<Material>(p_resource).is_valid()) {
+		materials.push_back(p_resource);
+	}
+
+	int preview_size = GLOBAL_GET("material_x/streaming/preview_size");
+	Vector<ObjectID> resumed;
+	for (int i = 0; i < materials.size(); i++) {
+		if (materials[i].is_null()) {
+			continue;
+		}
+		List<PropertyInfo> properties;
+		materials[i]->get_property_list(&properties);
+		for (const PropertyInfo &property : properties) {
+			if (property.type != Variant::OBJECT) {
+				continue;
+			}
+			Ref<ImageTexture> texture = materials[i]->get(property.name);
+			// Textures saved after their full image was swapped in need nothing.
+			if (texture.is_null() || !texture->has_meta(MTLX_STREAM_PATH_META) || resumed.has(texture->get_instance_id()) ||
+					MAX(texture->get_width(), texture->get_height()) > preview_size) {
+				continue;
+			}
+			resumed.push_back(texture->get_instance_id());
+			String path = texture->get_meta(MTLX_STREAM_PATH_META);
+			if (p_stream) {
+				request(texture, path, texture->get_image());
+				continue;
+			}
+			Ref<Image> image = ResourceLoader::load(path, "Image", ResourceFormatLoader::CACHE_MODE_IGNORE);
+			if (image.is_valid()) {
+				texture->create_from_image(image);
+			}
+		}
+	}
+}
+
+void MTLXTextureStreamer::finish() {
+	if (!singleton) {
+		return;
+	}
+	exit.set();
+	for (int i = 0; i < threads.size(); i++) {
+		semaphore.post();
+	}
+	for (int i = 0; i < threads.size(); i++) {
+		threads[i]->wait_to_finish();
+		memdelete(threads[i]);
+	}
+	threads.clear();
+	queue.clear();
+	resident.clear();
+	resident_size = 0;
+	memdelete(singleton);
+	singleton = nullptr;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/object/object.h"
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
+#include "core/templates/list.h"
+#include "core/templates/safe_refcount.h"
+#include "scene/resources/texture.h"
+
+// Progressive loading of the textures of imported materials. Along with each
+// mipmapped image stored in the import folder, the importer writes a preview
+// holding only its lowest mips; loads bind the preview and request the full
+// image here. Background threads read it and swap it into the texture on the
+// main thread. Full images stay resident within the configured budget; past
+// it, the oldest streamed textures fall back to their preview.
+//
+// Requested textures remember the path of their full image, so that materials
+// saved while still bound to previews stream it again once loaded.
+class MTLXTextureStreamer : public Object {
+	GDCLASS(MTLXTextureStreamer, Object);
+
+	struct Request {
+		ObjectID texture;
+		String path;
+		Ref<Image> preview;
+		uint64_t size = 0;
+	};
+
+	static Mutex mutex;
+	static Semaphore semaphore;
+	static List<Request> queue;
+	static List<Request> resident;
+	static uint64_t resident_size;
+	static Vector<Thread *> threads;
+	static SafeFlag exit;
+	static MTLXTextureStreamer *singleton;
+
+	static void _thread_func(void *p_user);
+	static void _stream(Request &p_request);
+	void _swap_image(uint64_t p_texture, const Ref<Image> &p_image);
+
+public:
+	static bool is_enabled();
+	static uint64_t get_budget();
+	static String get_preview_path(const String &p_image_path);
+	// The mips of a mipmapped image no larger than the preview size, or null
+	// when the image is already that small.
+	static Ref<Image> create_preview(const Ref<Image> &p_image);
+
+	static void request(const Ref<ImageTexture> &p_texture, const String &p_image_path, const Ref<Image> &p_preview);
+	// Requests the full image of every preview bound to a loaded material or
+	// collection, or loads it right away when not streaming.
+	static void resume(const RES &p_resource, bool p_stream);
+	static void finish();
+};
@@ -1,15 +1,55 @@
 #include "register_types.h"
 
 #include "material_x_3d.h"
+#include "material_x_bake_worker.h"
+#include "material_x_batch_import.h"
+#include "material_x_library.h"
+#include "material_x_material_collection.h"
+#include "material_x_profiler.h"
+#include "material_x_shader_cache.h"
+#include "material_x_texture_cache.h"
+#include "material_x_texture_streamer.h"
+
+#include "core/config/project_settings.h"
 
 static Ref<MTLXLoader> resource_format_mtlx;
 
 void register_material_x_types() {
+	GLOBAL_DEF("material_x/texture_cache/budget_mb", 256);
+	ProjectSettings::get_singleton()->set_custom_property_info("material_x/texture_cache/budget_mb", PropertyInfo(Variant::INT, "material_x/texture_cache/budget_mb", PROPERTY_HINT_RANGE, "0,8192,1,or_greater"));
+	// Bind low mips on load and stream full-resolution textures in the background.
+	GLOBAL_DEF("material_x/streaming/enabled", true);
+	GLOBAL_DEF("material_x/streaming/preview_size", 64);
+	GLOBAL_DEF("material_x/streaming/budget_mb", 512);
+	ProjectSettings::get_singleton()->set_custom_property_info("material_x/streaming/budget_mb", PropertyInfo(Variant::INT, "material_x/streaming/budget_mb", PROPERTY_HINT_RANGE, "0,16384,1,or_greater"));
+	GLOBAL_DEF("material_x/streaming/threads", 2);
+	// Translate materials to ShaderMaterials instead of baking them to textures.
+	GLOBAL_DEF("material_x/import/generate_shaders", false);
+	// Evaluate baked graphs on the CPU, for hosts without an OpenGL context.
+	GLOBAL_DEF("material_x/import/cpu_baking", false);
+	// Bake in this many worker processes, isolating the editor from bake failures; 0 bakes in process.
+	GLOBAL_DEF("material_x/import/bake_workers", 0);
+	ProjectSettings::get_singleton()->set_custom_property_info("material_x/import/bake_workers", PropertyInfo(Variant::INT, "material_x/import/bake_workers", PROPERTY_HINT_RANGE, "0,64,1"));
+	GDREGISTER_CLASS(MTLXMaterialCollection);
+	GDREGISTER_CLASS(MTLXBatchImport);
+	GDREGISTER_CLASS(MTLXBakeWorker);
+	if (MTLXBatchImport::is_requested()) {
+		// Run the batch import instead of the scene tree.
+		ProjectSettings::get_singleton()->set_setting("application/run/main_loop_type", "MTLXBatchImport");
+	} else if (MTLXBakeWorker::is_requested()) {
+		ProjectSettings::get_singleton()->set_setting("application/run/main_loop_type", "MTLXBakeWorker");
+	}
 	resource_format_mtlx.instantiate();
 	ResourceLoader::add_resource_format_loader(resource_format_mtlx);
 }
 
 void unregister_material_x_types() {
 	ResourceLoader::remove_resource_format_loader(resource_format_mtlx);
+	resource_format_mtlx->finish();
 	resource_format_mtlx.unref();
+	MTLXTextureStreamer::finish();
+	MTLXProfiler::unregister_monitors();
+	MTLXLibrary::clear();
+	MTLXShaderCache::clear();
+	MTLXTextureCache::clear();
 }
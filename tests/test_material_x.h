@@ -0,0 +1,508 @@
+#pragma once
+
+#include "modules/material_x/material_x_godot_shader_generator.h"
+#include "modules/material_x/material_x_library.h"
+
+#include "core/io/dir_access.h"
+#include "core/os/os.h"
+#include "tests/test_macros.h"
+
+#include <MaterialXFormat/Util.h>
+#include <MaterialXFormat/XmlIo.h>
+#include <MaterialXGenShader/GenContext.h>
+#include <MaterialXRender/StbImageLoader.h>
+#include <MaterialXRenderGlsl/CpuTextureBaker.h>
+
+#include <fstream>
+
+namespace TestMaterialX {
+
+// A texture node and a surface shader implemented inline, so that shaders are
+// generated without the data libraries.
+static const char *MTLX_TEST_DOCUMENT = R"(<?xml version="1.0"?>
+<materialx version="1.38">
+  <nodedef name="ND_test_scale_color3" node="test_scale" nodegroup="math">
+    <input name="in" type="color3" value="0.5, 0.25, 1.0" />
+    <input name="amount" type="float" value="1.0" />
+    <output name="out" type="color3" />
+  </nodedef>
+  <implementation name="IM_test_scale_color3" nodedef="ND_test_scale_color3" target="genglsl" sourcecode="{{in}} * {{amount}}" />
+  <nodedef name="ND_test_surface" node="test_surface" nodegroup="pbr">
+    <input name="base_color" type="color3" value="1.0, 1.0, 1.0" />
+    <input name="roughness" type="float" value="1.0" />
+    <output name="out" type="surfaceshader" />
+  </nodedef>
+  <implementation name="IM_test_surface" nodedef="ND_test_surface" target="genglsl" sourcecode="surfaceshader(vec3(0.0), vec3(0.0))" />
+  <test_scale name="scale" type="color3">
+    <input name="amount" type="float" value="0.00001" />
+  </test_scale>
+  <test_surface name="surface" type="surfaceshader">
+    <input name="base_color" type="color3" nodename="scale" />
+    <input name="roughness" type="float" value="2" />
+  </test_surface>
+</materialx>
+)";
+
+std::string generate_test_shader() {
+	// The generator includes the math library, which the test node doesn't use.
+	String root = OS::get_singleton()->get_cache_path().plus_file("materialx_tests");
+	String lib = root.plus_file("stdlib/genglsl/lib");
+	DirAccessRef d = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+	d->make_dir_recursive(lib);
+	std::ofstream(lib.plus_file("mx_math.glsl").utf8().get_data()) << "// Unused." << std::endl;
+
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::readFromXmlString(doc, MTLX_TEST_DOCUMENT);
+	mx::GenContext context(MTLXGodotShaderGenerator::create());
+	context.registerSourceCodeSearchPath(mx::FilePath(root.utf8().get_data()));
+	mx::ShaderPtr shader = context.getShaderGenerator().generate("test", doc->getNode("surface"), context);
+	return shader ? MTLXGodotShaderGenerator::get_source_code(shader) : std::string();
+}
+
+TEST_CASE("[MaterialX] Generated shaders compile") {
+	std::string code = generate_test_shader();
+	REQUIRE_FALSE(code.empty());
+	CHECK_MESSAGE(code.find("shader_type spatial") != std::string::npos, "Generated code should be a spatial shader.");
+	CHECK_MESSAGE(code.find("ALBEDO") != std::string::npos, "The base color should drive ALBEDO.");
+	CHECK_MESSAGE(code.find("0.000010") != std::string::npos, "Small values should be written in fixed notation.");
+	CHECK_MESSAGE(code.find("e-") == std::string::npos, "Values should never be written in scientific notation.");
+	String error = MTLXGodotShaderGenerator::validate_source_code(String(code.c_str()));
+	CHECK_MESSAGE(error.is_empty(), vformat("Generated code should compile, got %s", error));
+}
+
+TEST_CASE("[MaterialX] Shader validation") {
+	CHECK(MTLXGodotShaderGenerator::validate_source_code("shader_type spatial;\nvoid fragment() {\n\tALBEDO = vec3(1.0);\n}\n").is_empty());
+	CHECK_FALSE(MTLXGodotShaderGenerator::validate_source_code("shader_type spatial;\nvoid fragment() {\n\tALBEDO = mx_undefined(1.0);\n}\n").is_empty());
+	CHECK_FALSE(MTLXGodotShaderGenerator::validate_source_code("shader_type spatial;\nvoid fragment() {\n\tROUGHNESS = 1;\n}\n").is_empty());
+}
+
+TEST_CASE("[MaterialX] Shader literals ignore the global float format") {
+	mx::ShaderGeneratorPtr generator = MTLXGodotShaderGenerator::create();
+	const mx::Syntax &syntax = generator->getSyntax();
+	mx::Value::setFloatFormat(mx::Value::FloatFormatScientific);
+	mx::Value::setFloatPrecision(2);
+	std::string scalar = syntax.getValue(mx::Type::FLOAT, *mx::Value::createValue(0.00001f));
+	std::string vector = syntax.getValue(mx::Type::COLOR3, *mx::Value::createValue(mx::Color3(1.0f, 0.5f, 0.0f)));
+	mx::Value::setFloatFormat(mx::Value::FloatFormatDefault);
+	mx::Value::setFloatPrecision(6);
+	CHECK(scalar == "0.000010");
+	CHECK(vector == "vec3(1.000000, 0.500000, 0.000000)");
+}
+
+// A procedural material reading colors in both color spaces the CPU baker handles.
+static const char *MTLX_BAKE_DOCUMENT = R"(<?xml version="1.0"?>
+<materialx version="1.38" colorspace="lin_rec709">
+  <ramplr name="ramp" type="color3">
+    <input name="valuel" type="color3" value="0.8, 0.2, 0.1" colorspace="srgb_texture" />
+    <input name="valuer" type="color3" value="0.1, 0.3, 0.9" />
+  </ramplr>
+  <ramptb name="roughness" type="float">
+    <input name="valuet" type="float" value="0.2" />
+    <input name="valueb" type="float" value="0.7" />
+  </ramptb>
+  <standard_surface name="surface" type="surfaceshader">
+    <input name="base_color" type="color3" nodename="ramp" />
+    <input name="specular_roughness" type="float" nodename="roughness" />
+  </standard_surface>
+  <surfacematerial name="material" type="material">
+    <input name="surfaceshader" type="surfaceshader" nodename="surface" />
+  </surfacematerial>
+</materialx>
+)";
+
+std::vector<mx::ImagePtr> bake_test_images(mx::TextureBakerPtr p_baker, mx::DocumentPtr p_doc, const mx::FileSearchPath &p_search_path, const mx::FilePath &p_folder) {
+	std::vector<mx::ImagePtr> images;
+	p_baker->setOutputImagePath(p_folder);
+	p_baker->setOutputStream(nullptr);
+	mx::ImageHandlerPtr loader = mx::ImageHandler::create(mx::StbImageLoader::create());
+	for (const std::pair<std::string, mx::DocumentPtr> &baked : p_baker->bakeMaterialsToDocs(p_doc, p_search_path, { p_doc->getNode("material") })) {
+		for (mx::ElementPtr elem : baked.second->traverseTree()) {
+			mx::InputPtr input = elem->asA<mx::Input>();
+			if (input && input->getType() == mx::FILENAME_TYPE_STRING) {
+				images.push_back(loader->loadImage(input->getValueString()));
+			}
+		}
+	}
+	return images;
+}
+
+TEST_CASE("[MaterialX] CPU baking matches GL baking") {
+	// The data libraries are found through MATERIALX_SEARCH_PATH.
+	mx::FileSearchPath search_path = mx::getEnvironmentPath();
+	mx::DocumentPtr std_lib = mx::createDocument();
+	if (search_path.isEmpty() || mx::loadLibraries({ "libraries" }, search_path, std_lib).empty()) {
+		MESSAGE("MATERIALX_SEARCH_PATH doesn't hold the MaterialX data libraries, skipping.");
+		return;
+	}
+	mx::TextureBakerPtr gl_baker;
+	try {
+		gl_baker = mx::TextureBaker::create(64, 64, mx::Image::BaseType::UINT8);
+	} catch (std::exception &e) {
+		MESSAGE(vformat("No OpenGL context for the GL baker (%s), skipping.", String(e.what())));
+		return;
+	}
+	mx::TextureBakerPtr cpu_baker = mx::CpuTextureBaker::create(64, 64, mx::Image::BaseType::UINT8);
+
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::readFromXmlString(doc, MTLX_BAKE_DOCUMENT);
+	doc->importLibrary(std_lib);
+	String root = OS::get_singleton()->get_cache_path().plus_file("materialx_tests");
+	DirAccessRef d = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+	d->make_dir_recursive(root.plus_file("gl"));
+	d->make_dir_recursive(root.plus_file("cpu"));
+	std::vector<mx::ImagePtr> gl_images = bake_test_images(gl_baker, doc, search_path, root.plus_file("gl").utf8().get_data());
+	std::vector<mx::ImagePtr> cpu_images = bake_test_images(cpu_baker, doc, search_path, root.plus_file("cpu").utf8().get_data());
+
+	REQUIRE(gl_images.size() == 2);
+	REQUIRE(cpu_images.size() == gl_images.size());
+	for (size_t i = 0; i < gl_images.size(); i++) {
+		REQUIRE(gl_images[i]);
+		REQUIRE(cpu_images[i]);
+		REQUIRE(gl_images[i]->getWidth() == cpu_images[i]->getWidth());
+		REQUIRE(gl_images[i]->getHeight() == cpu_images[i]->getHeight());
+		float max_error = 0.0f;
+		for (unsigned int y = 0; y < gl_images[i]->getHeight(); y++) {
+			for (unsigned int x = 0; x < gl_images[i]->getWidth(); x++) {
+				mx::Color4 difference = gl_images[i]->getTexelColor(x, y) - cpu_images[i]->getTexelColor(x, y);
+				for (size_t c = 0; c < 4; c++) {
+					max_error = MAX(max_error, ABS(difference[c]));
+				}
+			}
+		}
+		// One step of 8-bit quantization either way.
+		CHECK_MESSAGE(max_error <= 1.5f / 255.0f, vformat("Baked image %d differs by up to %f.", (int)i, max_error));
+	}
+}
+
+TEST_CASE("[MaterialX] CPU baking rejects unsupported color spaces") {
+	mx::FileSearchPath search_path = mx::getEnvironmentPath();
+	mx::DocumentPtr std_lib = mx::createDocument();
+	if (search_path.isEmpty() || mx::loadLibraries({ "libraries" }, search_path, std_lib).empty()) {
+		MESSAGE("MATERIALX_SEARCH_PATH doesn't hold the MaterialX data libraries, skipping.");
+		return;
+	}
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::readFromXmlString(doc, MTLX_BAKE_DOCUMENT);
+	doc->importLibrary(std_lib);
+	doc->getNode("ramp")->getInput("valuel")->setColorSpace("acescg");
+
+	mx::TextureBakerPtr cpu_baker = mx::CpuTextureBaker::create(16, 16, mx::Image::BaseType::UINT8);
+	String root = OS::get_singleton()->get_cache_path().plus_file("materialx_tests");
+	DirAccessRef d = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+	d->make_dir_recursive(root.plus_file("cpu"));
+	cpu_baker->setOutputImagePath(root.plus_file("cpu").utf8().get_data());
+	cpu_baker->setOutputStream(nullptr);
+	CHECK_THROWS(cpu_baker->bakeMaterialsToDocs(doc, search_path, { doc->getNode("material") }));
+}
+
+// A procedural material passing through a custom node implemented inline.
+static const char *MTLX_INLINE_BAKE_DOCUMENT = R"(<?xml version="1.0"?>
+<materialx version="1.38">
+  <nodedef name="ND_test_tint_color3" node="test_tint" nodegroup="math">
+    <input name="in" type="color3" value="1.0, 1.0, 1.0" />
+    <output name="out" type="color3" />
+  </nodedef>
+  <implementation name="IM_test_tint_color3" nodedef="ND_test_tint_color3" target="genglsl" sourcecode="{{in}} * 0.5" />
+  <ramplr name="ramp" type="color3">
+    <input name="valuel" type="color3" value="0.8, 0.2, 0.1" />
+    <input name="valuer" type="color3" value="0.1, 0.3, 0.9" />
+  </ramplr>
+  <test_tint name="tint" type="color3">
+    <input name="in" type="color3" nodename="ramp" />
+  </test_tint>
+  <standard_surface name="surface" type="surfaceshader">
+    <input name="base_color" type="color3" nodename="tint" />
+  </standard_surface>
+  <surfacematerial name="material" type="material">
+    <input name="surfaceshader" type="surfaceshader" nodename="surface" />
+  </surfacematerial>
+</materialx>
+)";
+
+TEST_CASE("[MaterialX] Editing inline source code invalidates the bake cache") {
+	mx::FileSearchPath search_path = mx::getEnvironmentPath();
+	mx::DocumentPtr std_lib = mx::createDocument();
+	if (search_path.isEmpty() || mx::loadLibraries({ "libraries" }, search_path, std_lib).empty()) {
+		MESSAGE("MATERIALX_SEARCH_PATH doesn't hold the MaterialX data libraries, skipping.");
+		return;
+	}
+	mx::TextureBakerPtr baker;
+	try {
+		baker = mx::TextureBaker::create(16, 16, mx::Image::BaseType::UINT8);
+	} catch (std::exception &e) {
+		MESSAGE(vformat("No OpenGL context for the GL baker (%s), skipping.", String(e.what())));
+		return;
+	}
+
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::readFromXmlString(doc, MTLX_INLINE_BAKE_DOCUMENT);
+	doc->importLibrary(std_lib);
+	String root = OS::get_singleton()->get_cache_path().plus_file("materialx_tests");
+	String cache = root.plus_file(vformat("bake_cache_%d_%d", OS::get_singleton()->get_process_id(), (int64_t)OS::get_singleton()->get_ticks_usec()));
+	DirAccessRef d = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+	d->make_dir_recursive(root.plus_file("inline"));
+	d->make_dir_recursive(cache.plus_file("images"));
+	baker->setBakeCache(cache.utf8().get_data());
+	baker->setContentImagePath(cache.plus_file("images").utf8().get_data());
+	mx::FilePath folder = root.plus_file("inline").utf8().get_data();
+
+	bake_test_images(baker, doc, search_path, folder);
+	unsigned int misses = baker->getStatistics().cacheMissCount;
+	CHECK(misses > 0);
+	bake_test_images(baker, doc, search_path, folder);
+	CHECK(baker->getStatistics().cacheMissCount == misses);
+
+	doc->getImplementation("IM_test_tint_color3")->setAttribute("sourcecode", "{{in}} * 0.25");
+	bake_test_images(baker, doc, search_path, folder);
+	CHECK(baker->getStatistics().cacheMissCount > misses);
+}
+
+TEST_CASE("[MaterialX] Referenced libraries resolve qualified names") {
+	mx::DocumentPtr lib = mx::createDocument();
+	lib->setNamespace("ns");
+	mx::NodeDefPtr node_def = lib->addNodeDef("ND_baz", "float", "baz");
+	lib->freeze();
+
+	mx::DocumentPtr doc = mx::createDocument();
+	doc->referenceLibrary(lib);
+	mx::DocumentPtr copy = doc->copy();
+	CHECK(copy->getReferencedLibraries().size() == 1);
+
+	mx::NodeGraphPtr graph = copy->addNodeGraph("graph");
+	mx::NodePtr node = graph->addNodeInstance(copy->getNodeDefs()[0]);
+	CHECK(node->getNodeDefString() == "ns:ND_baz");
+	CHECK(node->getNodeDef() == node_def);
+
+	mx::NodeDefPtr local_def = copy->addNodeDef("ND_local", "float", "baz");
+	CHECK(node->getReferenceName(local_def) == "ND_local");
+}
+
+TEST_CASE("[MaterialX] Value strings parse as stream extraction did") {
+	CHECK(mx::fromValueString<float>("1e-50") == 0.0f);
+	CHECK(mx::fromValueString<double>("-1e-400") == 0.0);
+	CHECK(mx::fromValueString<float>("+1") == 1.0f);
+	CHECK(mx::fromValueString<float>(" -.5") == -0.5f);
+	CHECK(mx::fromValueString<mx::Vector3>("1e-50, 1, 2") == mx::Vector3(0.0f, 1.0f, 2.0f));
+	CHECK_THROWS(mx::fromValueString<float>("1e40"));
+	CHECK_THROWS(mx::fromValueString<float>("inf"));
+	CHECK_THROWS(mx::fromValueString<float>("-inf"));
+	CHECK_THROWS(mx::fromValueString<float>("nan"));
+	CHECK_THROWS(mx::fromValueString<mx::Vector3>("1, nan, 2"));
+}
+
+TEST_CASE("[MaterialX] Benchmark value string parsing and formatting") {
+	const int iterations = 100000;
+	std::vector<std::string> strings;
+	strings.reserve(iterations);
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < iterations; i++) {
+		strings.push_back(mx::toValueString(mx::Vector4((i % 1000) * 0.5f, -1.5f, 0.25f, 1234.5f)));
+	}
+	uint64_t formatted = OS::get_singleton()->get_ticks_usec() - begin;
+
+	float sum = 0.0f;
+	begin = OS::get_singleton()->get_ticks_usec();
+	for (const std::string &string : strings) {
+		sum += mx::fromValueString<mx::Vector4>(string)[0];
+	}
+	uint64_t parsed = OS::get_singleton()->get_ticks_usec() - begin;
+
+	CHECK(sum > 0.0f);
+	CHECK(mx::fromValueString<mx::Vector4>(strings.back()) == mx::Vector4(((iterations - 1) % 1000) * 0.5f, -1.5f, 0.25f, 1234.5f));
+	MESSAGE(vformat("%d vector4 values: %d us formatting, %d us parsing.", iterations, formatted, parsed));
+}
+
+// Open a document against the shared data libraries as an import does,
+// returning the time taken in microseconds.
+uint64_t time_test_import(const mx::FilePath &p_path, mx::DocumentPtr &r_std_lib) {
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	mx::FileSearchPath search_path(MTLXLibrary::get_library_folder().getParentPath());
+	search_path.append(p_path.getParentPath());
+	r_std_lib = MTLXLibrary::get(search_path);
+	if (!r_std_lib) {
+		return 0;
+	}
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::readFromXmlFile(doc, p_path, search_path);
+	doc->referenceLibrary(r_std_lib);
+	doc->validate();
+	return OS::get_singleton()->get_ticks_usec() - begin;
+}
+
+TEST_CASE("[MaterialX] Imports share the data libraries") {
+	if (!MTLXLibrary::get_library_folder().exists()) {
+		MESSAGE("res://libraries doesn't hold the MaterialX data libraries, skipping.");
+		return;
+	}
+	String root = OS::get_singleton()->get_cache_path().plus_file("materialx_tests");
+	DirAccessRef d = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+	d->make_dir_recursive(root);
+	String path = root.plus_file("import.mtlx");
+	std::ofstream(path.utf8().get_data()) << MTLX_BAKE_DOCUMENT;
+
+	MTLXLibrary::clear();
+	mx::DocumentPtr cold_lib;
+	mx::DocumentPtr warm_lib;
+	uint64_t cold = time_test_import(path.utf8().get_data(), cold_lib);
+	uint64_t warm = time_test_import(path.utf8().get_data(), warm_lib);
+	REQUIRE(cold_lib);
+	CHECK(warm_lib == cold_lib);
+	CHECK(warm < cold);
+	MESSAGE(vformat("Import with a cold library: %d us, warm: %d us, saved %d us per import.", cold, warm, (int64_t)cold - (int64_t)warm));
+}
+
+TEST_CASE("[MaterialX] Element values are cached until edited") {
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::NodePtr node = doc->addNode("constant", "constant", "color3");
+	mx::InputPtr input = node->addInput("value", "color3");
+	input->setValueString("0.1, 0.2, 0.3");
+
+	mx::ValuePtr value = input->getValue();
+	REQUIRE(value);
+	CHECK(input->getValue() == value);
+	CHECK(value->asA<mx::Color3>() == mx::Color3(0.1f, 0.2f, 0.3f));
+
+	input->setValueString("0.4, 0.5, 0.6");
+	CHECK(input->getValue() != value);
+	CHECK(input->getValue()->asA<mx::Color3>() == mx::Color3(0.4f, 0.5f, 0.6f));
+
+	input->setValue(mx::Color3(0.7f, 0.8f, 0.9f));
+	CHECK(input->getValue()->asA<mx::Color3>() == mx::Color3(0.7f, 0.8f, 0.9f));
+
+	input->setAttribute(mx::ValueElement::VALUE_ATTRIBUTE, "1, 1, 1");
+	CHECK(input->getValue()->asA<mx::Color3>() == mx::Color3(1.0f, 1.0f, 1.0f));
+
+	input->setType("vector3");
+	REQUIRE(input->getValue());
+	CHECK(input->getValue()->getTypeString() == "vector3");
+
+	input->removeAttribute(mx::ValueElement::VALUE_ATTRIBUTE);
+	CHECK(!input->getValue());
+}
+
+TEST_CASE("[MaterialX] Benchmark repeated getValue") {
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::NodePtr node = doc->addNode("constant", "constant", "matrix44");
+	mx::InputPtr input = node->addInput("value", "matrix44");
+	input->setValue(mx::Matrix44::IDENTITY);
+	const std::string value_string = input->getValueString();
+	const int iterations = 100000;
+	int valid = 0;
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < iterations; i++) {
+		valid += mx::Value::createValueFromStrings(value_string, "matrix44") ? 1 : 0;
+	}
+	uint64_t parsed = OS::get_singleton()->get_ticks_usec() - begin;
+
+	begin = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < iterations; i++) {
+		valid += input->getValue() ? 1 : 0;
+	}
+	uint64_t cached = OS::get_singleton()->get_ticks_usec() - begin;
+
+	CHECK(valid == 2 * iterations);
+	MESSAGE(vformat("%d getValue calls: %d us parsing each time, %d us cached.", iterations, parsed, cached));
+	CHECK(cached < parsed);
+}
+
+// A document with a node read by another, whose lookup cache is built before
+// the edits each test makes, so that the edits update it incrementally.
+mx::DocumentPtr create_cache_test_document() {
+	mx::DocumentPtr doc = mx::createDocument();
+	doc->addNode("constant", "a", "float");
+	doc->addNode("add", "b", "float")->addInput("in1", "float")->setNodeName("a");
+	doc->addNodeDef("ND_foo_float", "float", "foo");
+	CHECK(doc->getMatchingPorts("a").size() == 1);
+	CHECK(doc->getMatchingNodeDefs("foo").size() == 1);
+	return doc;
+}
+
+TEST_CASE("[MaterialX] Document cache indexes added elements") {
+	mx::DocumentPtr doc = create_cache_test_document();
+	doc->addNode("add", "c", "float")->addInput("in1", "float")->setNodeName("a");
+	mx::NodeDefPtr node_def = doc->addNodeDef("ND_foo_color3", "color3", "foo");
+	mx::ImplementationPtr impl = doc->addImplementation("IM_foo_color3");
+	impl->setNodeDef(node_def);
+
+	CHECK(doc->getMatchingPorts("a").size() == 2);
+	CHECK(doc->getMatchingNodeDefs("foo").size() == 2);
+	CHECK(doc->getNodeDefs().size() == 2);
+	CHECK(doc->getMatchingImplementations("ND_foo_color3").size() == 1);
+	CHECK(node_def->getImplementation() == impl);
+}
+
+TEST_CASE("[MaterialX] Document cache follows renamed elements") {
+	mx::DocumentPtr doc = create_cache_test_document();
+	doc->getNode("a")->setName("a2");
+	doc->getNode("b")->getInput("in1")->setNodeName("a2");
+	mx::NodeDefPtr node_def = doc->getNodeDef("ND_foo_float");
+	node_def->setNodeString("bar");
+	node_def->setName("ND_bar_float");
+
+	CHECK(doc->getMatchingPorts("a").empty());
+	CHECK(doc->getMatchingPorts("a2").size() == 1);
+	CHECK(doc->getMatchingNodeDefs("foo").empty());
+	CHECK(doc->getMatchingNodeDefs("bar").size() == 1);
+	CHECK(doc->getNodeDef("ND_bar_float") == node_def);
+	CHECK(doc->getNodeDefs().size() == 1);
+
+	// Namespaces qualify the keys of every element below them.
+	doc->setNamespace("ns");
+	CHECK(doc->getMatchingPorts("ns:a2").size() == 1);
+	CHECK(doc->getMatchingNodeDefs("ns:bar").size() == 1);
+}
+
+TEST_CASE("[MaterialX] Document cache drops removed elements") {
+	mx::DocumentPtr doc = create_cache_test_document();
+	mx::ImplementationPtr impl = doc->addImplementation("IM_foo_float");
+	impl->setNodeDef(doc->getNodeDef("ND_foo_float"));
+	CHECK(doc->getMatchingImplementations("ND_foo_float").size() == 1);
+
+	doc->removeNode("b");
+	doc->removeImplementation("IM_foo_float");
+	doc->removeNodeDef("ND_foo_float");
+
+	CHECK(doc->getMatchingPorts("a").empty());
+	CHECK(doc->getMatchingImplementations("ND_foo_float").empty());
+	CHECK(doc->getMatchingNodeDefs("foo").empty());
+	CHECK(doc->getNodeDefs().empty());
+
+	// A cache built from scratch agrees.
+	mx::DocumentPtr copy = doc->copy();
+	CHECK(copy->getMatchingPorts("a").empty());
+	CHECK(copy->getMatchingNodeDefs("foo").empty());
+}
+
+TEST_CASE("[MaterialX] Frozen documents reject edits and serve reads") {
+	mx::DocumentPtr doc = mx::createDocument();
+	mx::NodeDefPtr node_def = doc->addNodeDef("ND_foo_float", "float", "foo");
+	node_def->addInput("in", "float")->setValueString("0.5");
+	mx::NodePtr node = doc->addNode("foo", "node", "float");
+	node->setNodeDefString("ND_foo_float");
+	doc->freeze();
+	CHECK(doc->isFrozen());
+
+	CHECK_THROWS_AS(doc->addNode("foo", "other", "float"), mx::ExceptionFrozenDocument);
+	CHECK_THROWS_AS(doc->removeNode("node"), mx::ExceptionFrozenDocument);
+	CHECK_THROWS_AS(node->setName("renamed"), mx::ExceptionFrozenDocument);
+	CHECK_THROWS_AS(node->setAttribute("doc", "edited"), mx::ExceptionFrozenDocument);
+	CHECK_THROWS_AS(node_def->getInput("in")->setValueString("1.0"), mx::ExceptionFrozenDocument);
+	CHECK_THROWS_AS(doc->setNamespace("ns"), mx::ExceptionFrozenDocument);
+
+	CHECK(doc->getNode("node") == node);
+	CHECK(doc->getNodeDef("ND_foo_float") == node_def);
+	CHECK(doc->getMatchingNodeDefs("foo").size() == 1);
+	CHECK(node->getNodeDef() == node_def);
+	CHECK(node_def->getInput("in")->getValue()->asA<float>() == 0.5f);
+	CHECK(doc->validate());
+
+	// A frozen document may be shared as a library by documents that are edited.
+	mx::DocumentPtr user = mx::createDocument();
+	user->referenceLibrary(doc);
+	mx::NodePtr instance = user->addNodeInstance(node_def, "instance");
+	CHECK(instance->getNodeDef() == node_def);
+}
+
+} // namespace TestMaterialX
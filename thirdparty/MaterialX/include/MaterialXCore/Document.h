@@ -45,11 +45,13 @@ class MX_CORE_API Document : public GraphElement
     /// Initialize the document, removing any existing content.
     virtual void initialize();
 
-    /// Create a deep copy of the document.
+    /// Create a deep copy of the document.  Referenced libraries are shared
+    /// with the copy rather than copied.
     virtual DocumentPtr copy() const
     {
         DocumentPtr doc = createDocument<Document>();
         doc->copyContentFrom(getSelf());
+        doc->_libraries = _libraries;
         return doc;
     }
 
@@ -59,6 +61,25 @@ class MX_CORE_API Document : public GraphElement
     /// @param library The library document to be imported.
     void importLibrary(const ConstDocumentPtr& library);
 
+    /// Reference the given document as a library layer of this document.
+    /// Rather than being copied, the library is shared: lookups of definitions
+    /// by name, and the getMatchingNodeDefs and getMatchingImplementations
+    /// queries, fall through to it when this document has no match, and the
+    /// elements they return belong to the library.  Elements of this document
+    /// take precedence over those of its libraries, and earlier libraries over
+    /// later ones, as with importLibrary.  Library elements keep their own
+    /// names, and are referenced from this document by their name qualified
+    /// with the library namespace, as returned by Element::getReferenceName.
+    /// @param library The library document to be referenced, which must be
+    ///    frozen so that it can be shared safely.
+    void referenceLibrary(const ConstDocumentPtr& library);
+
+    /// Return the libraries referenced by this document, in lookup order.
+    const vector<ConstDocumentPtr>& getReferencedLibraries() const
+    {
+        return _libraries;
+    }
+
     /// Get a list of source URI's referenced by the document
     StringSet getReferencedSourceUris() const;
 
@@ -76,9 +97,10 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the NodeGraph, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     NodeGraphPtr getNodeGraph(const string& name) const
     {
-        return getChildOfType<NodeGraph>(name);
+        return getLayeredChildOfType<NodeGraph>(name);
     }
 
     /// Return a vector of all NodeGraph elements in the document.
@@ -152,15 +174,17 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the GeomPropDef, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     GeomPropDefPtr getGeomPropDef(const string& name) const
     {
-        return getChildOfType<GeomPropDef>(name);
+        return getLayeredChildOfType<GeomPropDef>(name);
     }
 
     /// Return a vector of all GeomPropDef elements in the document.
+    /// Elements of referenced libraries are included.
     vector<GeomPropDefPtr> getGeomPropDefs() const
     {
-        return getChildrenOfType<GeomPropDef>();
+        return getLayeredChildrenOfType<GeomPropDef>();
     }
 
     /// Remove the GeomPropDef, if any, with the given name.
@@ -287,15 +311,17 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the TypeDef, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     TypeDefPtr getTypeDef(const string& name) const
     {
-        return getChildOfType<TypeDef>(name);
+        return getLayeredChildOfType<TypeDef>(name);
     }
 
     /// Return a vector of all TypeDef elements in the document.
+    /// Elements of referenced libraries are included.
     vector<TypeDefPtr> getTypeDefs() const
     {
-        return getChildrenOfType<TypeDef>();
+        return getLayeredChildrenOfType<TypeDef>();
     }
 
     /// Remove the TypeDef, if any, with the given name.
@@ -347,15 +373,17 @@ class MX_CORE_API Document : public GraphElement
                                    bool isDefaultVersion, const string& nodeGroup, string& newGraphName);
 
     /// Return the NodeDef, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     NodeDefPtr getNodeDef(const string& name) const
     {
-        return getChildOfType<NodeDef>(name);
+        return getLayeredChildOfType<NodeDef>(name);
     }
 
     /// Return a vector of all NodeDef elements in the document.
+    /// Elements of referenced libraries are included.
     vector<NodeDefPtr> getNodeDefs() const
     {
-        return getChildrenOfType<NodeDef>();
+        return getLayeredChildrenOfType<NodeDef>();
     }
 
     /// Remove the NodeDef, if any, with the given name.
@@ -382,15 +410,17 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the AttributeDef, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     AttributeDefPtr getAttributeDef(const string& name) const
     {
-        return getChildOfType<AttributeDef>(name);
+        return getLayeredChildOfType<AttributeDef>(name);
     }
 
     /// Return a vector of all AttributeDef elements in the document.
+    /// Elements of referenced libraries are included.
     vector<AttributeDefPtr> getAttributeDefs() const
     {
-        return getChildrenOfType<AttributeDef>();
+        return getLayeredChildrenOfType<AttributeDef>();
     }
 
     /// Remove the AttributeDef, if any, with the given name.
@@ -414,15 +444,17 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the AttributeDef, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     TargetDefPtr getTargetDef(const string& name) const
     {
-        return getChildOfType<TargetDef>(name);
+        return getLayeredChildOfType<TargetDef>(name);
     }
 
     /// Return a vector of all TargetDef elements in the document.
+    /// Elements of referenced libraries are included.
     vector<TargetDefPtr> getTargetDefs() const
     {
-        return getChildrenOfType<TargetDef>();
+        return getLayeredChildrenOfType<TargetDef>();
     }
 
     /// Remove the TargetDef, if any, with the given name.
@@ -510,15 +542,17 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the Implementation, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     ImplementationPtr getImplementation(const string& name) const
     {
-        return getChildOfType<Implementation>(name);
+        return getLayeredChildOfType<Implementation>(name);
     }
 
     /// Return a vector of all Implementation elements in the document.
+    /// Elements of referenced libraries are included.
     vector<ImplementationPtr> getImplementations() const
     {
-        return getChildrenOfType<Implementation>();
+        return getLayeredChildrenOfType<Implementation>();
     }
 
     /// Remove the Implementation, if any, with the given name.
@@ -546,15 +580,16 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the UnitDef, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     UnitDefPtr getUnitDef(const string& name) const
     {
-        return getChildOfType<UnitDef>(name);
+        return getLayeredChildOfType<UnitDef>(name);
     }
 
     /// Return a vector of all Member elements in the TypeDef.
     vector<UnitDefPtr> getUnitDefs() const
     {
-        return getChildrenOfType<UnitDef>();
+        return getLayeredChildrenOfType<UnitDef>();
     }
 
     /// Remove the UnitDef, if any, with the given name.
@@ -577,15 +612,17 @@ class MX_CORE_API Document : public GraphElement
     }
 
     /// Return the UnitTypeDef, if any, with the given name.
+    /// Referenced libraries are searched if the document has no match.
     UnitTypeDefPtr getUnitTypeDef(const string& name) const
     {
-        return getChildOfType<UnitTypeDef>(name);
+        return getLayeredChildOfType<UnitTypeDef>(name);
     }
 
     /// Return a vector of all UnitTypeDef elements in the document.
+    /// Elements of referenced libraries are included.
     vector<UnitTypeDefPtr> getUnitTypeDefs() const
     {
-        return getChildrenOfType<UnitTypeDef>();
+        return getLayeredChildrenOfType<UnitTypeDef>();
     }
 
     /// Remove the UnitTypeDef, if any, with the given name.
@@ -667,6 +704,15 @@ class MX_CORE_API Document : public GraphElement
     /// Invalidate cached data for optimized lookups within the given document.
     void invalidateCache();
 
+    /// Freeze the document for sharing between threads.  The lookup cache is
+    /// built once, and lookups then run without locking; any later edit to
+    /// the document throws an ExceptionFrozenDocument.  A document must be
+    /// frozen before other threads start reading it.
+    void freeze();
+
+    /// Return true if the document has been frozen.
+    bool isFrozen() const;
+
     /// @}
 
   public:
@@ -674,15 +720,67 @@ class MX_CORE_API Document : public GraphElement
     static const string CMS_ATTRIBUTE;
     static const string CMS_CONFIG_ATTRIBUTE;
 
+  protected:
+    ElementPtr getLayeredChild(const string& name) const override;
+
   private:
+    friend class Element;
+
+    // Return the child with the given name and subclass, if any, in this
+    // document or its referenced libraries.
+    template <class T> shared_ptr<T> getLayeredChildOfType(const string& name) const
+    {
+        ElementPtr child = getLayeredChild(name);
+        return child ? child->asA<T>() : shared_ptr<T>();
+    }
+
+    // Return the children of the given subclass in this document, followed by
+    // those of its referenced libraries that aren't hidden by an earlier one.
+    // Library children keep their own names; getReferenceName returns the
+    // qualified names by which they are looked up from this document.
+    template <class T> vector<shared_ptr<T>> getLayeredChildrenOfType() const
+    {
+        vector<shared_ptr<T>> children = getChildrenOfType<T>();
+        StringSet libraryNames;
+        for (const ConstDocumentPtr& library : _libraries)
+        {
+            for (shared_ptr<T> child : library->getLayeredChildrenOfType<T>())
+            {
+                const string name = library->getQualifiedName(child->getName());
+                if (!getChild(name) && libraryNames.insert(name).second)
+                {
+                    children.push_back(child);
+                }
+            }
+        }
+        return children;
+    }
+
+    // Throw if the document is frozen; called before any edit.
+    void checkMutable() const;
+
+    // Keep the lookup cache up to date with an edit to the document.
+    void onElementAdded(ElementPtr elem);
+    void onElementRemoved(ElementPtr elem);
+    void onElementAttributeChanged(Element* elem, const string& attrib);
+
     class Cache;
     std::unique_ptr<Cache> _cache;
+    vector<ConstDocumentPtr> _libraries;
 };
 
 /// Create a new Document.
 /// @relates Document
 MX_CORE_API DocumentPtr createDocument();
 
+/// @class ExceptionFrozenDocument
+/// An exception that is thrown when a frozen Document is edited.
+class MX_CORE_API ExceptionFrozenDocument : public Exception
+{
+  public:
+    using Exception::Exception;
+};
+
 MATERIALX_NAMESPACE_END
 
 #endif
@@ -349,6 +349,12 @@ class MX_CORE_API Element : public std::enable_shared_from_this<Element>
         return name;
     }
 
+    /// Return the name by which the given element is referenced from the scope
+    /// of this element.  Elements of a library referenced by this element's
+    /// document are referenced by their qualified name, as importLibrary names
+    /// their copies.
+    string getReferenceName(ConstElementPtr elem) const;
+
     /// @}
     /// @name Documentation String
     /// @{
@@ -766,8 +772,14 @@ class MX_CORE_API Element : public std::enable_shared_from_this<Element>
     template <class T> shared_ptr<T> resolveRootNameReference(const string& name) const
     {
         ConstElementPtr root = getRoot();
-        shared_ptr<T> child = root->getChildOfType<T>(getQualifiedName(name));
-        return child ? child : root->getChildOfType<T>(name);
+        ElementPtr child = root->getLayeredChild(getQualifiedName(name));
+        shared_ptr<T> typedChild = child ? child->asA<T>() : shared_ptr<T>();
+        if (!typedChild)
+        {
+            child = root->getLayeredChild(name);
+            typedChild = child ? child->asA<T>() : shared_ptr<T>();
+        }
+        return typedChild;
     }
 
     /// @}
@@ -787,9 +799,20 @@ class MX_CORE_API Element : public std::enable_shared_from_this<Element>
     static const string DOC_ATTRIBUTE;
 
   protected:
+    // Return the child element, if any, with the given name, including those
+    // of any libraries that this element references as layers.
+    virtual ElementPtr getLayeredChild(const string& name) const
+    {
+        return getChild(name);
+    }
+
     virtual void registerChildElement(ElementPtr child);
     virtual void unregisterChildElement(ElementPtr child);
 
+    // Called after the given attribute of this element is set or removed, or
+    // with an empty name after all of its attributes are replaced.
+    virtual void onAttributeChanged(const string&) { }
+
     // Return a non-const copy of our self pointer, for use in constructing
     // graph traversal objects that require non-const storage.
     ElementPtr getSelfNonConst() const
@@ -993,14 +1016,13 @@ class MX_CORE_API ValueElement : public TypedElement
     /// Return the typed value of an element as a generic value object, which
     /// may be queried to access its data.
     ///
+    /// The value is parsed once and cached until the value or type of the
+    /// element changes, so the returned object is shared between callers and
+    /// must not be modified.
+    ///
     /// @return A shared pointer to the typed value of this element, or an
     ///    empty shared pointer if no value is present.
-    ValuePtr getValue() const
-    {
-        if (!hasValue())
-            return ValuePtr();
-        return Value::createValueFromStrings(getValueString(), getType());
-    }
+    ValuePtr getValue() const;
 
     /// Return the resolved value of an element as a generic value object, which
     /// may be queried to access its data.
@@ -1010,12 +1032,7 @@ class MX_CORE_API ValueElement : public TypedElement
     ///    will be created at this scope and applied to the return value.
     /// @return A shared pointer to the typed value of this element, or an
     ///    empty shared pointer if no value is present.
-    ValuePtr getResolvedValue(StringResolverPtr resolver = nullptr) const
-    {
-        if (!hasValue())
-            return ValuePtr();
-        return Value::createValueFromStrings(getResolvedValueString(resolver), getType());
-    }
+    ValuePtr getResolvedValue(StringResolverPtr resolver = nullptr) const;
 
     /// Return the default value for this element as a generic value object, which
     /// may be queried to access its data.
@@ -1112,6 +1129,14 @@ class MX_CORE_API ValueElement : public TypedElement
     static const string UNIT_ATTRIBUTE;
     static const string UNITTYPE_ATTRIBUTE;
     static const string UNIFORM_ATTRIBUTE;
+
+  protected:
+    void onAttributeChanged(const string& attrib) override;
+
+  private:
+    // Parsed value, accessed atomically so that readers on several threads
+    // may share it.
+    mutable ValuePtr _cachedValue;
 };
 
 /// @class Token
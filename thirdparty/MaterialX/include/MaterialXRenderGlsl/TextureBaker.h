@@ -190,6 +190,61 @@ class MX_RENDERGLSL_API TextureBaker : public GlslRenderer
         return _hashImageNames;
     }
 
+    /// Set the folder in which baked images are stored by content.  Each distinct
+    /// image is then written once, named after a hash of its pixels, and baked
+    /// documents reference the shared file.  Images of UDIM sets are always
+    /// stored by name.  Defaults to an empty path, which disables the feature.
+    void setContentImagePath(const FilePath& path)
+    {
+        _contentImagePath = path;
+    }
+
+    /// Return the folder in which baked images are stored by content.
+    const FilePath& getContentImagePath() const
+    {
+        return _contentImagePath;
+    }
+
+    /// Set the folder of a persistent cache of bake results.  Each baked output
+    /// is keyed by its upstream graph along with the definitions and
+    /// implementations of its nodes, the baker backend, the baking resolution,
+    /// base type and color space, and the content of the files it reads; a hit reuses the
+    /// stored result without generating or rendering anything.  The given salt
+    /// is folded into every key, and should identify the data libraries.  Only
+    /// uniform results are cached unless a content image path is also set.
+    void setBakeCache(const FilePath& path, const string& salt = EMPTY_STRING)
+    {
+        _bakeCachePath = path;
+        _bakeCacheSalt = salt;
+    }
+
+    /// Return the folder of the persistent cache of bake results.
+    const FilePath& getBakeCachePath() const
+    {
+        return _bakeCachePath;
+    }
+
+    /// @class BakeStatistics
+    /// Timings in seconds and event counts accumulated by a baker.
+    class BakeStatistics
+    {
+      public:
+        double generationTime = 0.0;
+        double renderTime = 0.0;
+        double imageWriteTime = 0.0;
+        unsigned int generationCount = 0;
+        unsigned int renderCount = 0;
+        unsigned int imageWriteCount = 0;
+        unsigned int cacheHitCount = 0;
+        unsigned int cacheMissCount = 0;
+    };
+
+    /// Return the timings and counts accumulated by this baker since its creation.
+    const BakeStatistics& getStatistics() const
+    {
+        return _statistics;
+    }
+
     /// Set up the unit definitions to be used in baking.
     void setupUnitSystem(DocumentPtr unitDefinitions);
 
@@ -197,7 +252,12 @@ class MX_RENDERGLSL_API TextureBaker : public GlslRenderer
     void bakeShaderInputs(NodePtr material, NodePtr shader, GenContext& context, const string& udim = EMPTY_STRING);
 
     /// Bake a texture for the given graph output.
-    void bakeGraphOutput(OutputPtr output, GenContext& context, const StringMap& filenameTemplateMap);
+    virtual void bakeGraphOutput(OutputPtr output, GenContext& context, const StringMap& filenameTemplateMap);
+
+    /// Bake textures for several graph outputs of a material.  The default
+    /// implementation bakes each output in turn; derived bakers may evaluate
+    /// them in a single pass, sharing the work of their common upstream nodes.
+    virtual void bakeGraphOutputs(const vector<OutputPtr>& outputs, GenContext& context, const vector<StringMap>& filenameTemplateMaps);
 
     /// Optimize baked textures before writing.
     void optimizeBakedTextures(NodePtr shader);
@@ -210,6 +270,17 @@ class MX_RENDERGLSL_API TextureBaker : public GlslRenderer
     /// then the given output filename will be used as a template.
     void bakeAllMaterials(DocumentPtr doc, const FileSearchPath& searchPath, const FilePath& outputFileName);
 
+    /// Bake materials in the given document to memory, returning one baked document per material.
+    /// Baked textures are written to the output image path, which should be set beforehand.
+    BakedDocumentVec bakeAllMaterialsToDocs(DocumentPtr doc, const FileSearchPath& searchPath);
+
+    /// Bake the given renderable elements of a document to memory, returning one baked document per material.
+    BakedDocumentVec bakeMaterialsToDocs(DocumentPtr doc, const FileSearchPath& searchPath, const vector<TypedElementPtr>& materials);
+
+    /// Write baked documents to disk.  If multiple documents are given, then the given
+    /// output filename will be used as a template.
+    void writeBakedDocuments(const BakedDocumentVec& bakedDocuments, const FilePath& outputFileName);
+
   protected:
     class BakedImage
     {
@@ -229,7 +300,9 @@ class MX_RENDERGLSL_API TextureBaker : public GlslRenderer
     using BakedConstantMap = std::unordered_map<OutputPtr, BakedConstant>;
 
   protected:
-    TextureBaker(unsigned int width, unsigned int height, Image::BaseType baseType);
+    /// Construct a baker.  The OpenGL renderer is only initialized when requested, so that
+    /// derived bakers evaluating graphs by other means don't require a GPU.
+    TextureBaker(unsigned int width, unsigned int height, Image::BaseType baseType, bool initializeRenderer = true);
 
     // Populate file template variable naming map
     StringMap initializeFileTemplateMap(InputPtr input, NodePtr shader, const string& udim = EMPTY_STRING);
@@ -246,6 +319,32 @@ class MX_RENDERGLSL_API TextureBaker : public GlslRenderer
     // Write a baked image to disk, returning true if the write was successful.
     bool writeBakedImage(const BakedImage& baked, ImagePtr image);
 
+    // Record the contents of the frame capture image as the baked image of the given graph output.
+    void storeBakedImage(OutputPtr output, const StringMap& filenameTemplateMap);
+
+    // Return the name under which an image is stored by content.
+    static string getImageContentHash(ImagePtr image);
+
+    // Return the name of the backend evaluating graphs, by which bake cache keys are qualified.
+    virtual string getBackendName() const
+    {
+        return "glsl";
+    }
+
+    // Return the bake cache key of a graph output, resolving implementation
+    // files on the source code search path of the given context.
+    string getBakeCacheKey(OutputPtr output, const GenContext& context);
+
+    // Return the hash of the contents of a file, which is read once per baker.
+    const string& getFileContentHash(const FilePath& path);
+
+    // Record the cached result of a graph output as its baked image, returning
+    // false if there is none.
+    bool readBakeCache(const string& key, OutputPtr output, const StringMap& filenameTemplateMap);
+
+    // Store the baked image of a graph output in the bake cache.
+    void writeBakeCache(const string& key, OutputPtr output);
+
   protected:
     string _extension;
     string _colorSpace;
@@ -258,6 +357,11 @@ class MX_RENDERGLSL_API TextureBaker : public GlslRenderer
     string _textureFilenameTemplate;
     std::ostream* _outputStream;
     bool _hashImageNames;
+    FilePath _contentImagePath;
+    FilePath _bakeCachePath;
+    string _bakeCacheSalt;
+    std::unordered_map<string, string> _fileContentHashes;
+    BakeStatistics _statistics;
 
     ShaderGeneratorPtr _generator;
     ConstNodePtr _material;
@@ -120,7 +120,7 @@ void Implementation::setNodeDef(ConstNodeDefPtr nodeDef)
 {
     if (nodeDef)
     {
-        setNodeDefString(nodeDef->getName());
+        setNodeDefString(getReferenceName(nodeDef));
     }
     else
     {
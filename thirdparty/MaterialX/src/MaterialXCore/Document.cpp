@@ -7,6 +7,7 @@
 
 #include <MaterialXCore/Util.h>
 
+#include <atomic>
 #include <mutex>
 
 MATERIALX_NAMESPACE_BEGIN
@@ -65,13 +66,20 @@ class Document::Cache
 {
   public:
     Cache() :
-        valid(false)
+        valid(false),
+        frozen(false)
     {
     }
     ~Cache() { }
 
     void refresh()
     {
+        // A frozen cache is complete and never changes.
+        if (frozen.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
         // Thread synchronization for multiple concurrent readers of a single document.
         std::lock_guard<std::mutex> guard(mutex);
 
@@ -81,70 +89,169 @@ class Document::Cache
             portElementMap.clear();
             nodeDefMap.clear();
             implementationMap.clear();
+            elementKeyMap.clear();
 
             // Traverse the document to build a new cache.
             for (ElementPtr elem : doc.lock()->traverseTree())
             {
-                const string& nodeName = elem->getAttribute(PortElement::NODE_NAME_ATTRIBUTE);
-                const string& nodeString = elem->getAttribute(NodeDef::NODE_ATTRIBUTE);
-                const string& nodeDefString = elem->getAttribute(InterfaceElement::NODE_DEF_ATTRIBUTE);
-
-                if (!nodeName.empty())
-                {
-                    PortElementPtr portElem = elem->asA<PortElement>();
-                    if (portElem)
-                    {
-                        portElementMap.emplace(portElem->getQualifiedName(nodeName), portElem);
-                    }
-                }
-                if (!nodeString.empty())
-                {
-                    NodeDefPtr nodeDef = elem->asA<NodeDef>();
-                    if (nodeDef)
-                    {
-                        nodeDefMap.emplace(nodeDef->getQualifiedName(nodeString), nodeDef);
-                    }
-                }
-                if (!nodeDefString.empty())
-                {
-                    InterfaceElementPtr interface = elem->asA<InterfaceElement>();
-                    if (interface)
-                    {
-                        if (interface->isA<NodeGraph>())
-                        {
-                            implementationMap.emplace(interface->getQualifiedName(nodeDefString), interface);
-                        }
-                        ImplementationPtr impl = interface->asA<Implementation>();
-                        if (impl)
-                        {
-                            // Check for implementation which specifies a nodegraph as the implementation
-                            const string& nodeGraphString = impl->getNodeGraph();
-                            if (!nodeGraphString.empty())
-                            {
-                                NodeGraphPtr nodeGraph = impl->getDocument()->getNodeGraph(nodeGraphString);
-                                if (nodeGraph)
-                                    implementationMap.emplace(interface->getQualifiedName(nodeDefString), nodeGraph);
-                            }
-                            else
-                            {
-                                implementationMap.emplace(interface->getQualifiedName(nodeDefString), interface);
-                            }
-                        }
-                    }
-                }
+                addElement(elem);
             }
 
             valid = true;
         }
     }
 
+    // Index a newly added element, along with its descendants.
+    void addSubtree(ElementPtr elem)
+    {
+        ElementPtr parent = elem->getParent();
+        if (!valid || !parent || !elementKeyMap.count(parent.get()))
+        {
+            return;
+        }
+        for (ElementPtr desc : elem->traverseTree())
+        {
+            addElement(desc);
+        }
+    }
+
+    // Drop a removed element and its descendants from the index.
+    void removeSubtree(ElementPtr elem)
+    {
+        if (!valid || !elementKeyMap.count(elem.get()))
+        {
+            return;
+        }
+        for (ElementPtr desc : elem->traverseTree())
+        {
+            removeElement(desc);
+        }
+    }
+
+    // Update the index for a change to the given attribute of an element, or to
+    // all of its attributes if the attribute name is empty.
+    void updateAttribute(Element* elem, const string& attrib)
+    {
+        if (!valid || !elementKeyMap.count(elem))
+        {
+            return;
+        }
+        if (attrib.empty() || attrib == Element::NAMESPACE_ATTRIBUTE)
+        {
+            // Namespaces qualify the keys of all descendants.
+            for (ElementPtr desc : elem->getSelf()->traverseTree())
+            {
+                removeElement(desc);
+                addElement(desc);
+            }
+        }
+        else if (attrib == PortElement::NODE_NAME_ATTRIBUTE ||
+                 attrib == NodeDef::NODE_ATTRIBUTE ||
+                 attrib == InterfaceElement::NODE_DEF_ATTRIBUTE)
+        {
+            ElementPtr self = elem->getSelf();
+            removeElement(self);
+            addElement(self);
+        }
+    }
+
+  private:
+    // Keys under which an element is indexed, empty for maps it isn't in.
+    struct ElementKeys
+    {
+        string port;
+        string nodeDef;
+        string implementation;
+    };
+
+    template <class T> static void eraseEntry(std::unordered_multimap<string, T>& map, const string& key, Element* elem)
+    {
+        auto keyRange = map.equal_range(key);
+        for (auto it = keyRange.first; it != keyRange.second; ++it)
+        {
+            if (it->second.get() == elem)
+            {
+                map.erase(it);
+                return;
+            }
+        }
+    }
+
+    void addElement(ElementPtr elem)
+    {
+        ElementKeys& keys = elementKeyMap[elem.get()];
+
+        const string& nodeName = elem->getAttribute(PortElement::NODE_NAME_ATTRIBUTE);
+        const string& nodeString = elem->getAttribute(NodeDef::NODE_ATTRIBUTE);
+        const string& nodeDefString = elem->getAttribute(InterfaceElement::NODE_DEF_ATTRIBUTE);
+
+        if (!nodeName.empty())
+        {
+            PortElementPtr portElem = elem->asA<PortElement>();
+            if (portElem)
+            {
+                keys.port = portElem->getQualifiedName(nodeName);
+                portElementMap.emplace(keys.port, portElem);
+            }
+        }
+        if (!nodeString.empty())
+        {
+            NodeDefPtr nodeDef = elem->asA<NodeDef>();
+            if (nodeDef)
+            {
+                keys.nodeDef = nodeDef->getQualifiedName(nodeString);
+                nodeDefMap.emplace(keys.nodeDef, nodeDef);
+            }
+        }
+        if (!nodeDefString.empty())
+        {
+            // Implementations referencing a nodegraph are resolved at lookup
+            // time, so that later edits to the nodegraph need no update here.
+            InterfaceElementPtr interface = elem->asA<InterfaceElement>();
+            if (interface && (interface->isA<NodeGraph>() || interface->isA<Implementation>()))
+            {
+                keys.implementation = interface->getQualifiedName(nodeDefString);
+                implementationMap.emplace(keys.implementation, interface);
+            }
+        }
+    }
+
+    void removeElement(ElementPtr elem)
+    {
+        auto it = elementKeyMap.find(elem.get());
+        if (it == elementKeyMap.end())
+        {
+            return;
+        }
+        const ElementKeys& keys = it->second;
+        if (!keys.port.empty())
+        {
+            eraseEntry(portElementMap, keys.port, elem.get());
+        }
+        if (!keys.nodeDef.empty())
+        {
+            eraseEntry(nodeDefMap, keys.nodeDef, elem.get());
+        }
+        if (!keys.implementation.empty())
+        {
+            eraseEntry(implementationMap, keys.implementation, elem.get());
+        }
+        elementKeyMap.erase(it);
+    }
+
   public:
     weak_ptr<Document> doc;
     std::mutex mutex;
     bool valid;
+    std::atomic<bool> frozen;
     std::unordered_multimap<string, PortElementPtr> portElementMap;
     std::unordered_multimap<string, NodeDefPtr> nodeDefMap;
     std::unordered_multimap<string, InterfaceElementPtr> implementationMap;
+
+  private:
+    // Every element in the index, including those without keys, so that edits
+    // to elements that have been removed from the document are ignored.
+    std::unordered_map<const Element*, ElementKeys> elementKeyMap;
 };
 
 //
@@ -265,6 +372,45 @@ void Document::importLibrary(const ConstDocumentPtr& library)
     }
 }
 
+void Document::referenceLibrary(const ConstDocumentPtr& library)
+{
+    if (!library)
+    {
+        return;
+    }
+    if (!library->isFrozen())
+    {
+        throw Exception("Referenced library must be frozen: " + library->getSourceUri());
+    }
+    _libraries.push_back(library);
+}
+
+ElementPtr Document::getLayeredChild(const string& name) const
+{
+    ElementPtr child = getChild(name);
+    for (size_t i = 0; !child && i < _libraries.size(); i++)
+    {
+        // Library elements are named as importLibrary would name their copies.
+        const ConstDocumentPtr& library = _libraries[i];
+        const string& namespaceStr = library->getNamespace();
+        if (namespaceStr.empty())
+        {
+            child = library->getLayeredChild(name);
+        }
+        else if (name.size() > namespaceStr.size() &&
+                 name.compare(0, namespaceStr.size(), namespaceStr) == 0 &&
+                 name.compare(namespaceStr.size(), NAME_PREFIX_SEPARATOR.size(), NAME_PREFIX_SEPARATOR) == 0)
+        {
+            child = library->getLayeredChild(name);
+            if (!child)
+            {
+                child = library->getLayeredChild(name.substr(namespaceStr.size() + NAME_PREFIX_SEPARATOR.size()));
+            }
+        }
+    }
+    return child;
+}
+
 StringSet Document::getReferencedSourceUris() const
 {
     StringSet sourceUris;
@@ -358,6 +504,13 @@ vector<NodeDefPtr> Document::getMatchingNodeDefs(const string& nodeName) const
         nodeDefs.push_back(it->second);
     }
 
+    // Append the matches of referenced libraries.
+    for (const ConstDocumentPtr& library : _libraries)
+    {
+        vector<NodeDefPtr> libraryNodeDefs = library->getMatchingNodeDefs(nodeName);
+        nodeDefs.insert(nodeDefs.end(), libraryNodeDefs.begin(), libraryNodeDefs.end());
+    }
+
     // Return the matches.
     return nodeDefs;
 }
@@ -372,7 +525,28 @@ vector<InterfaceElementPtr> Document::getMatchingImplementations(const string& n
     auto keyRange = _cache->implementationMap.equal_range(nodeDef);
     for (auto it = keyRange.first; it != keyRange.second; ++it)
     {
-        implementations.push_back(it->second);
+        // Check for implementation which specifies a nodegraph as the implementation
+        ImplementationPtr impl = it->second->asA<Implementation>();
+        const string& nodeGraphString = impl ? impl->getNodeGraph() : EMPTY_STRING;
+        if (!nodeGraphString.empty())
+        {
+            NodeGraphPtr nodeGraph = getNodeGraph(nodeGraphString);
+            if (nodeGraph)
+            {
+                implementations.push_back(nodeGraph);
+            }
+        }
+        else
+        {
+            implementations.push_back(it->second);
+        }
+    }
+
+    // Append the matches of referenced libraries.
+    for (const ConstDocumentPtr& library : _libraries)
+    {
+        vector<InterfaceElementPtr> libraryImplementations = library->getMatchingImplementations(nodeDef);
+        implementations.insert(implementations.end(), libraryImplementations.begin(), libraryImplementations.end());
     }
 
     // Return the matches.
@@ -1402,7 +1576,42 @@ void Document::upgradeVersion()
 
 void Document::invalidateCache()
 {
+    checkMutable();
     _cache->valid = false;
 }
 
+void Document::freeze()
+{
+    _cache->refresh();
+    _cache->frozen = true;
+}
+
+bool Document::isFrozen() const
+{
+    return _cache->frozen;
+}
+
+void Document::checkMutable() const
+{
+    if (_cache->frozen.load(std::memory_order_relaxed))
+    {
+        throw ExceptionFrozenDocument("Cannot edit frozen document: " + getSourceUri());
+    }
+}
+
+void Document::onElementAdded(ElementPtr elem)
+{
+    _cache->addSubtree(elem);
+}
+
+void Document::onElementRemoved(ElementPtr elem)
+{
+    _cache->removeSubtree(elem);
+}
+
+void Document::onElementAttributeChanged(Element* elem, const string& attrib)
+{
+    _cache->updateAttribute(elem, attrib);
+}
+
 MATERIALX_NAMESPACE_END
@@ -88,7 +88,7 @@ void Element::setName(const string& name)
         throw Exception("Element name is not unique at the given scope: " + name);
     }
 
-    getDocument()->invalidateCache();
+    getDocument()->checkMutable();
 
     if (parent)
     {
@@ -134,15 +134,20 @@ ElementPtr Element::getDescendant(const string& namePath) const
 
 void Element::registerChildElement(ElementPtr child)
 {
-    getDocument()->invalidateCache();
+    DocumentPtr doc = getDocument();
+    doc->checkMutable();
 
     _childMap[child->getName()] = child;
     _childOrder.push_back(child);
+
+    doc->onElementAdded(child);
 }
 
 void Element::unregisterChildElement(ElementPtr child)
 {
-    getDocument()->invalidateCache();
+    DocumentPtr doc = getDocument();
+    doc->checkMutable();
+    doc->onElementRemoved(child);
 
     _childMap.erase(child->getName());
     _childOrder.erase(
@@ -174,6 +179,8 @@ void Element::setChildIndex(const string& name, int index)
         throw Exception("Invalid child index");
     }
 
+    getDocument()->checkMutable();
+
     _childOrder.erase(it);
     _childOrder.insert(_childOrder.begin() + (size_t) index, child);
 }
@@ -191,13 +198,16 @@ void Element::removeChild(const string& name)
 
 void Element::setAttribute(const string& attrib, const string& value)
 {
-    getDocument()->invalidateCache();
+    DocumentPtr doc = getDocument();
+    doc->checkMutable();
 
     if (!_attributeMap.count(attrib))
     {
         _attributeOrder.push_back(attrib);
     }
     _attributeMap[attrib] = value;
+    onAttributeChanged(attrib);
+    doc->onElementAttributeChanged(this, attrib);
 }
 
 void Element::removeAttribute(const string& attrib)
@@ -205,11 +215,14 @@ void Element::removeAttribute(const string& attrib)
     StringMap::iterator it = _attributeMap.find(attrib);
     if (it != _attributeMap.end())
     {
-        getDocument()->invalidateCache();
+        DocumentPtr doc = getDocument();
+        doc->checkMutable();
 
         _attributeMap.erase(it);
         _attributeOrder.erase(
             std::find(_attributeOrder.begin(), _attributeOrder.end(), attrib));
+        onAttributeChanged(attrib);
+        doc->onElementAttributeChanged(this, attrib);
     }
 }
 
@@ -297,6 +310,15 @@ ConstElementPtr Element::getRoot() const
     return root;
 }
 
+string Element::getReferenceName(ConstElementPtr elem) const
+{
+    if (elem->getRoot() == getRoot())
+    {
+        return elem->getName();
+    }
+    return elem->getQualifiedName(elem->getName());
+}
+
 DocumentPtr Element::getDocument()
 {
     return getRoot()->asA<Document>();
@@ -360,11 +382,14 @@ InheritanceIterator Element::traverseInheritance() const
 
 void Element::copyContentFrom(const ConstElementPtr& source)
 {
-    getDocument()->invalidateCache();
+    DocumentPtr doc = getDocument();
+    doc->checkMutable();
 
     _sourceUri = source->_sourceUri;
     _attributeMap = source->_attributeMap;
     _attributeOrder = source->_attributeOrder;
+    onAttributeChanged(EMPTY_STRING);
+    doc->onElementAttributeChanged(this, EMPTY_STRING);
 
     for (auto child : source->getChildren())
     {
@@ -385,13 +410,20 @@ void Element::copyContentFrom(const ConstElementPtr& source)
 
 void Element::clearContent()
 {
-    getDocument()->invalidateCache();
+    DocumentPtr doc = getDocument();
+    doc->checkMutable();
+    for (ElementPtr child : _childOrder)
+    {
+        doc->onElementRemoved(child);
+    }
 
     _sourceUri.clear();
     _attributeMap.clear();
     _attributeOrder.clear();
     _childMap.clear();
     _childOrder.clear();
+    onAttributeChanged(EMPTY_STRING);
+    doc->onElementAttributeChanged(this, EMPTY_STRING);
 }
 
 bool Element::validate(string* message) const
@@ -478,6 +510,43 @@ TypeDefPtr TypedElement::getTypeDef() const
 // ValueElement methods
 //
 
+void ValueElement::onAttributeChanged(const string& attrib)
+{
+    if (attrib.empty() || attrib == VALUE_ATTRIBUTE || attrib == TYPE_ATTRIBUTE)
+    {
+        std::atomic_store(&_cachedValue, ValuePtr());
+    }
+}
+
+ValuePtr ValueElement::getValue() const
+{
+    if (!hasValue())
+    {
+        return ValuePtr();
+    }
+    ValuePtr value = std::atomic_load(&_cachedValue);
+    if (!value)
+    {
+        value = Value::createValueFromStrings(getValueString(), getType());
+        std::atomic_store(&_cachedValue, value);
+    }
+    return value;
+}
+
+ValuePtr ValueElement::getResolvedValue(StringResolverPtr resolver) const
+{
+    if (!hasValue())
+    {
+        return ValuePtr();
+    }
+    if (!StringResolver::isResolvedType(getType()))
+    {
+        // No substitutions apply, so the cached value can be shared.
+        return getValue();
+    }
+    return Value::createValueFromStrings(getResolvedValueString(resolver), getType());
+}
+
 string ValueElement::getResolvedValueString(StringResolverPtr resolver) const
 {
     if (!StringResolver::isResolvedType(getType()))
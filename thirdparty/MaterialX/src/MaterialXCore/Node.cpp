@@ -639,7 +639,7 @@ void NodeGraph::setNodeDef(ConstNodeDefPtr nodeDef)
 {
     if (nodeDef)
     {
-        setNodeDefString(nodeDef->getName());
+        setNodeDefString(getReferenceName(nodeDef));
     }
     else
     {
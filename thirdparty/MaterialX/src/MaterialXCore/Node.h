@@ -211,7 +211,7 @@ class MX_CORE_API GraphElement : public InterfaceElement
     NodePtr addNodeInstance(ConstNodeDefPtr nodeDef, const string& name = EMPTY_STRING)
     {
         NodePtr node = addNode(nodeDef->getNodeString(), name, nodeDef->getType());
-        node->setNodeDefString(nodeDef->getName());
+        node->setNodeDefString(node->getReferenceName(nodeDef));
         return node;
     }
 
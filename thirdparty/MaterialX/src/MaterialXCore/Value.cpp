@@ -5,7 +5,10 @@
 
 #include <MaterialXCore/Value.h>
 
+#include <cctype>
+#include <charconv>
 #include <iomanip>
+#include <locale>
 #include <sstream>
 #include <type_traits>
 
@@ -28,10 +31,100 @@ template <class T> class is_std_vector<vector<T>> : public std::true_type { };
 template <class T> using enable_if_std_vector_t =
     typename std::enable_if<is_std_vector<T>::value, T>::type;
 
+// Parse a floating-point scalar from a token by stream extraction in the
+// classic locale.
+template <class T> bool parseStream(const char* begin, const char* end, T& data)
+{
+    std::istringstream ss(string(begin, end));
+    ss.imbue(std::locale::classic());
+    return static_cast<bool>(ss >> data);
+}
+
+// Parse a scalar from a token, skipping leading whitespace and ignoring
+// trailing characters as stream extraction does, but independently of the
+// global locale.
+template <class T> bool parseToken(const char* begin, const char* end, T& data)
+{
+    while (begin != end && std::isspace((unsigned char) *begin))
+    {
+        begin++;
+    }
+    if (begin != end && *begin == '+')
+    {
+        begin++;
+        if (begin != end && *begin == '-')
+        {
+            return false;
+        }
+    }
+    if constexpr (std::is_floating_point<T>::value)
+    {
+#if defined(__cpp_lib_to_chars)
+        // Unlike stream extraction, from_chars accepts "inf" and "nan".
+        const char* digits = (begin != end && *begin == '-') ? begin + 1 : begin;
+        if (digits == end || !(std::isdigit((unsigned char) *digits) || *digits == '.'))
+        {
+            return false;
+        }
+        std::from_chars_result result = std::from_chars(begin, end, data);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            // Stream extraction flushes underflow to zero and fails on
+            // overflow, so let it decide.
+            return parseStream(begin, result.ptr, data);
+        }
+        return result.ec == std::errc();
+#else
+        // Floating-point from_chars is missing from this standard library.
+        return parseStream(begin, end, data);
+#endif
+    }
+    else
+    {
+        return std::from_chars(begin, end, data).ec == std::errc();
+    }
+}
+
+bool parseToken(const char* begin, const char* end, bool& data)
+{
+    if (VALUE_STRING_TRUE.compare(0, string::npos, begin, end - begin) == 0)
+        data = true;
+    else if (VALUE_STRING_FALSE.compare(0, string::npos, begin, end - begin) == 0)
+        data = false;
+    else
+        return false;
+    return true;
+}
+
+bool parseToken(const char* begin, const char* end, string& data)
+{
+    data.assign(begin, end);
+    return true;
+}
+
+// Find the next token of an array value string, as splitString would return
+// it, starting the search at the given position.
+bool nextToken(const string& str, size_t& pos, const char*& begin, const char*& end)
+{
+    pos = str.find_first_not_of(ARRAY_VALID_SEPARATORS, pos);
+    if (pos == string::npos)
+    {
+        return false;
+    }
+    size_t last = str.find_first_of(ARRAY_VALID_SEPARATORS, pos);
+    if (last == string::npos)
+    {
+        last = str.size();
+    }
+    begin = str.data() + pos;
+    end = str.data() + last;
+    pos = last;
+    return true;
+}
+
 template <class T> void stringToData(const string& str, T& data)
 {
-    std::stringstream ss(str);
-    if (!(ss >> data))
+    if (!parseToken(str.data(), str.data() + str.size(), data))
     {
         throw ExceptionTypeError("Type mismatch in generic stringToData: " + str);
     }
@@ -54,46 +147,102 @@ template <> void stringToData(const string& str, string& data)
 
 template <class T> void stringToData(const string& str, enable_if_mx_vector_t<T>& data)
 {
-    StringVec tokens = splitString(str, ARRAY_VALID_SEPARATORS);
-    if (tokens.size() != data.numElements())
+    size_t pos = 0;
+    size_t count = 0;
+    const char* begin;
+    const char* end;
+    while (nextToken(str, pos, begin, end))
     {
-        throw ExceptionTypeError("Type mismatch in vector stringToData: " + str);
+        if (count >= data.numElements() || !parseToken(begin, end, data[count]))
+        {
+            throw ExceptionTypeError("Type mismatch in vector stringToData: " + str);
+        }
+        count++;
     }
-    for (size_t i = 0; i < data.numElements(); i++)
+    if (count != data.numElements())
     {
-        stringToData(tokens[i], data[i]);
+        throw ExceptionTypeError("Type mismatch in vector stringToData: " + str);
     }
 }
 
 template <class T> void stringToData(const string& str, enable_if_mx_matrix_t<T>& data)
 {
-    StringVec tokens = splitString(str, ARRAY_VALID_SEPARATORS);
-    if (tokens.size() != data.numRows() * data.numColumns())
-    {
-        throw ExceptionTypeError("Type mismatch in matrix stringToData: " + str);
-    }
-    for (size_t i = 0; i < data.numRows(); i++)
+    size_t pos = 0;
+    size_t count = 0;
+    const char* begin;
+    const char* end;
+    const size_t size = data.numRows() * data.numColumns();
+    while (nextToken(str, pos, begin, end))
     {
-        for (size_t j = 0; j < data.numColumns(); j++)
+        if (count >= size || !parseToken(begin, end, data[count / data.numColumns()][count % data.numColumns()]))
         {
-            stringToData(tokens[i * data.numRows() + j], data[i][j]);
+            throw ExceptionTypeError("Type mismatch in matrix stringToData: " + str);
         }
+        count++;
+    }
+    if (count != size)
+    {
+        throw ExceptionTypeError("Type mismatch in matrix stringToData: " + str);
     }
 }
 
 template <class T> void stringToData(const string& str, enable_if_std_vector_t<T>& data)
 {
-    for (const string& token : splitString(str, ARRAY_VALID_SEPARATORS))
+    size_t pos = 0;
+    const char* begin;
+    const char* end;
+    while (nextToken(str, pos, begin, end))
     {
         typename T::value_type val;
-        stringToData(token, val);
+        if (!parseToken(begin, end, val))
+        {
+            throw ExceptionTypeError("Type mismatch in array stringToData: " + str);
+        }
         data.push_back(val);
     }
 }
 
+// Format a scalar with the current float format and precision, returning the
+// end of the text, or nullptr if it doesn't fit in the given buffer.
+template <class T> char* formatScalar(const T& data, char* begin, char* end)
+{
+    std::to_chars_result result;
+    if constexpr (std::is_floating_point<T>::value)
+    {
+#if defined(__cpp_lib_to_chars)
+        const int precision = Value::getFloatPrecision();
+        if (precision < 0)
+        {
+            return nullptr;
+        }
+        const Value::FloatFormat fmt = Value::getFloatFormat();
+        result = std::to_chars(begin, end, data,
+                               fmt == Value::FloatFormatFixed ? std::chars_format::fixed :
+                               (fmt == Value::FloatFormatScientific ? std::chars_format::scientific : std::chars_format::general),
+                               precision);
+#else
+        return nullptr;
+#endif
+    }
+    else
+    {
+        result = std::to_chars(begin, end, data);
+    }
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
 template <class T> void dataToString(const T& data, string& str)
 {
+    char buffer[128];
+    char* last = formatScalar(data, buffer, buffer + sizeof(buffer));
+    if (last)
+    {
+        str.assign(buffer, last);
+        return;
+    }
+
     std::stringstream ss;
+    ss.imbue(std::locale::classic());
 
     // Set float format and precision for the stream
     const Value::FloatFormat fmt = Value::getFloatFormat();
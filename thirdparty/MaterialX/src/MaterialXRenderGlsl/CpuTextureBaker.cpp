@@ -0,0 +1,1176 @@
+//
+// TM & (c) 2019 Lucasfilm Entertainment Company Ltd. and Lucasfilm Ltd.
+// All rights reserved.  See LICENSE.txt for license.
+//
+
+#include <MaterialXRenderGlsl/CpuTextureBaker.h>
+
+#include <MaterialXRender/Timer.h>
+
+#include <MaterialXGenGlsl/GlslShaderGenerator.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+MATERIALX_NAMESPACE_BEGIN
+
+namespace {
+
+const string SRGB_TEXTURE = "srgb_texture";
+const string LIN_REC709 = "lin_rec709";
+const unsigned int TILE_SIZE = 64;
+
+unsigned int getChannelCount(const string& type)
+{
+    if (type == "float" || type == "integer" || type == "boolean")
+    {
+        return 1;
+    }
+    if (type == "vector2")
+    {
+        return 2;
+    }
+    if (type == "color3" || type == "vector3")
+    {
+        return 3;
+    }
+    if (type == "color4" || type == "vector4")
+    {
+        return 4;
+    }
+    return 0;
+}
+
+vector<float> getValueFloats(ConstValuePtr value)
+{
+    if (value->isA<float>())
+    {
+        return { value->asA<float>() };
+    }
+    if (value->isA<int>())
+    {
+        return { (float) value->asA<int>() };
+    }
+    if (value->isA<bool>())
+    {
+        return { value->asA<bool>() ? 1.0f : 0.0f };
+    }
+    if (value->isA<Color3>())
+    {
+        const Color3& c = value->asA<Color3>();
+        return { c[0], c[1], c[2] };
+    }
+    if (value->isA<Color4>())
+    {
+        const Color4& c = value->asA<Color4>();
+        return { c[0], c[1], c[2], c[3] };
+    }
+    if (value->isA<Vector2>())
+    {
+        const Vector2& v = value->asA<Vector2>();
+        return { v[0], v[1] };
+    }
+    if (value->isA<Vector3>())
+    {
+        const Vector3& v = value->asA<Vector3>();
+        return { v[0], v[1], v[2] };
+    }
+    if (value->isA<Vector4>())
+    {
+        const Vector4& v = value->asA<Vector4>();
+        return { v[0], v[1], v[2], v[3] };
+    }
+    throw Exception("Unsupported value type '" + value->getTypeString() + "' in CPU texture baking");
+}
+
+float srgbToLinear(float value)
+{
+    // Matches mx_srgb_texture_to_lin_rec709.
+    return value > 0.04045f ? std::pow(std::max(value * 0.947867299f + 0.052132701f, 0.0f), 2.4f) : value * 0.077399380f;
+}
+
+// Return true if colors in the given color space are decoded from sRGB to
+// reach the linear Rec.709 working space, and false if they are already in it.
+// Other color spaces would need the transforms of the color management system.
+bool isSrgbColorSpace(const string& colorSpace, const string& elementPath)
+{
+    if (colorSpace == SRGB_TEXTURE)
+    {
+        return true;
+    }
+    if (colorSpace.empty() || colorSpace == LIN_REC709)
+    {
+        return false;
+    }
+    throw Exception("Color space '" + colorSpace + "' of '" + elementPath + "' is not supported by the CPU texture baker");
+}
+
+float linearToSrgb(float value)
+{
+    // Matches the sRGB encoding of the OpenGL frame buffer.
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// The values of a node output over all texels of a tile, with interleaved
+// channels.  Single channel buffers broadcast over any number of channels.
+struct TexelBuffer
+{
+    unsigned int channels = 1;
+    vector<float> data;
+
+    float get(size_t texel, unsigned int channel) const
+    {
+        return data[texel * channels + (channels == 1 ? 0 : channel)];
+    }
+};
+
+using TexelBufferPtr = std::shared_ptr<TexelBuffer>;
+
+// A rectangle of the baked image.
+struct Tile
+{
+    unsigned int x = 0;
+    unsigned int y = 0;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int imageWidth = 0;
+    unsigned int imageHeight = 0;
+
+    size_t getTexelCount() const
+    {
+        return (size_t) width * height;
+    }
+
+    // Texture coordinates at the center of the given texel, with the origin at the bottom left.
+    Vector2 getTexcoord(size_t texel) const
+    {
+        float u = ((float) (x + texel % width) + 0.5f) / (float) imageWidth;
+        float v = ((float) (y + texel / width) + 0.5f) / (float) imageHeight;
+        return Vector2(u, v);
+    }
+};
+
+// Images referenced by a graph, shared by all tiles.
+class ImageCache
+{
+  public:
+    explicit ImageCache(ImageHandlerPtr imageHandler) :
+        _imageHandler(imageHandler)
+    {
+    }
+
+    ImagePtr acquire(const string& filename)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _images.find(filename);
+        if (it != _images.end())
+        {
+            return it->second;
+        }
+        ImagePtr image = _imageHandler->acquireImage(filename);
+        _images[filename] = image;
+        return image;
+    }
+
+  private:
+    ImageHandlerPtr _imageHandler;
+    std::mutex _mutex;
+    std::unordered_map<string, ImagePtr> _images;
+};
+
+// Evaluates graph outputs over a single tile.
+class GraphEvaluator
+{
+  public:
+    GraphEvaluator(const Tile& tile, ImageCache& images) :
+        _tile(tile),
+        _images(images),
+        _texelCount(tile.getTexelCount())
+    {
+    }
+
+    /// Outputs of the same graph share a scope, so the nodes they have in
+    /// common are evaluated once.
+    TexelBufferPtr evaluate(OutputPtr output)
+    {
+        GraphElementPtr graph = output->getParent()->asA<GraphElement>();
+        Scope& scope = _graphScopes[graph];
+        scope.graph = graph;
+        return evaluateOutput(output, scope);
+    }
+
+  private:
+    // The graph in which nodes are evaluated.  Node graph implementations are
+    // evaluated in a child scope, whose interface is the calling node.
+    struct Scope
+    {
+        GraphElementPtr graph;
+        NodePtr instance;
+        Scope* parent = nullptr;
+        std::unordered_map<string, TexelBufferPtr> cache;
+    };
+
+    // A node being evaluated by a built-in implementation.
+    struct NodeContext
+    {
+        NodePtr node;
+        NodeDefPtr nodeDef;
+        string output;
+        unsigned int channels;
+        Scope* scope;
+    };
+
+    using Operator = TexelBufferPtr (GraphEvaluator::*)(const NodeContext&);
+
+    TexelBufferPtr createBuffer(unsigned int channels) const
+    {
+        TexelBufferPtr buffer = std::make_shared<TexelBuffer>();
+        buffer->channels = channels;
+        buffer->data.resize(_texelCount * channels);
+        return buffer;
+    }
+
+    TexelBufferPtr createConstant(const vector<float>& values) const
+    {
+        TexelBufferPtr buffer = createBuffer((unsigned int) values.size());
+        for (size_t i = 0; i < buffer->data.size(); i++)
+        {
+            buffer->data[i] = values[i % values.size()];
+        }
+        return buffer;
+    }
+
+    template <class F> TexelBufferPtr map1(const TexelBuffer& a, unsigned int channels, F f) const
+    {
+        TexelBufferPtr out = createBuffer(channels);
+        float* dst = out->data.data();
+        if (a.channels == channels)
+        {
+            const float* src = a.data.data();
+            for (size_t i = 0; i < out->data.size(); i++)
+            {
+                dst[i] = f(src[i]);
+            }
+            return out;
+        }
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            for (unsigned int c = 0; c < channels; c++)
+            {
+                dst[t * channels + c] = f(a.get(t, c));
+            }
+        }
+        return out;
+    }
+
+    template <class F> TexelBufferPtr map2(const TexelBuffer& a, const TexelBuffer& b, unsigned int channels, F f) const
+    {
+        TexelBufferPtr out = createBuffer(channels);
+        float* dst = out->data.data();
+        if (a.channels == channels && b.channels == channels)
+        {
+            const float* srcA = a.data.data();
+            const float* srcB = b.data.data();
+            for (size_t i = 0; i < out->data.size(); i++)
+            {
+                dst[i] = f(srcA[i], srcB[i]);
+            }
+            return out;
+        }
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            for (unsigned int c = 0; c < channels; c++)
+            {
+                dst[t * channels + c] = f(a.get(t, c), b.get(t, c));
+            }
+        }
+        return out;
+    }
+
+    template <class F> TexelBufferPtr map3(const TexelBuffer& a, const TexelBuffer& b, const TexelBuffer& d, unsigned int channels, F f) const
+    {
+        TexelBufferPtr out = createBuffer(channels);
+        float* dst = out->data.data();
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            for (unsigned int c = 0; c < channels; c++)
+            {
+                dst[t * channels + c] = f(a.get(t, c), b.get(t, c), d.get(t, c));
+            }
+        }
+        return out;
+    }
+
+    //
+    // Graph traversal
+    //
+
+    TexelBufferPtr evaluateOutput(OutputPtr output, Scope& scope)
+    {
+        if (output->hasInterfaceName())
+        {
+            return evaluateInterfaceInput(output->getInterfaceName(), scope);
+        }
+        NodePtr node = scope.graph->getNode(output->getNodeName());
+        if (!node)
+        {
+            throw Exception("Output '" + output->getNamePath() + "' is not connected to a node");
+        }
+        return evaluateNode(node, output->getOutputString(), scope);
+    }
+
+    TexelBufferPtr evaluateNode(NodePtr node, const string& outputName, Scope& scope)
+    {
+        NodeDefPtr nodeDef = node->getNodeDef(GlslShaderGenerator::TARGET);
+        if (!nodeDef)
+        {
+            throw Exception("Could not find a nodedef for node '" + node->getNamePath() + "'");
+        }
+        OutputPtr nodeDefOutput = outputName.empty() ? nodeDef->getActiveOutputs().front() : nodeDef->getActiveOutput(outputName);
+        if (!nodeDefOutput)
+        {
+            throw Exception("Invalid output '" + outputName + "' of node '" + node->getNamePath() + "'");
+        }
+
+        const string key = node->getNamePath() + "." + nodeDefOutput->getName();
+        auto cached = scope.cache.find(key);
+        if (cached != scope.cache.end())
+        {
+            return cached->second;
+        }
+
+        NodeContext context;
+        context.node = node;
+        context.nodeDef = nodeDef;
+        context.output = nodeDefOutput->getName();
+        context.channels = getChannelCount(nodeDefOutput->getType());
+        context.scope = &scope;
+
+        TexelBufferPtr result;
+        const std::unordered_map<string, Operator>& operators = getOperators();
+        auto op = operators.find(node->getCategory());
+        if (op != operators.end() && context.channels)
+        {
+            result = (this->*(op->second))(context);
+        }
+        else
+        {
+            InterfaceElementPtr impl = nodeDef->getImplementation(GlslShaderGenerator::TARGET);
+            NodeGraphPtr implGraph = impl ? impl->asA<NodeGraph>() : nullptr;
+            if (!implGraph)
+            {
+                throw Exception("Node '" + node->getCategory() + "' of type '" + nodeDefOutput->getType() + "' is not supported by the CPU texture baker");
+            }
+            Scope child;
+            child.graph = implGraph;
+            child.instance = node;
+            child.parent = &scope;
+            OutputPtr implOutput = implGraph->getOutput(context.output);
+            if (!implOutput)
+            {
+                throw Exception("Implementation graph '" + implGraph->getName() + "' has no output '" + context.output + "'");
+            }
+            result = evaluateOutput(implOutput, child);
+        }
+
+        scope.cache[key] = result;
+        return result;
+    }
+
+    // Evaluate an input of a node within its scope, falling back to the nodedef default.
+    TexelBufferPtr evaluateNodeInput(NodePtr node, NodeDefPtr nodeDef, const string& name, Scope& scope)
+    {
+        InputPtr input = node->getInput(name);
+        if (input)
+        {
+            return evaluateInputElement(input, scope);
+        }
+        if (!nodeDef)
+        {
+            nodeDef = node->getNodeDef(GlslShaderGenerator::TARGET);
+        }
+        InputPtr defInput = nodeDef ? nodeDef->getActiveInput(name) : nullptr;
+        if (!defInput)
+        {
+            throw Exception("Node '" + node->getNamePath() + "' has no input '" + name + "'");
+        }
+        if (defInput->hasDefaultGeomPropString())
+        {
+            return evaluateGeomProp(defInput->getDefaultGeomPropString(), getChannelCount(defInput->getType()));
+        }
+        if (!defInput->getValue())
+        {
+            throw Exception("Input '" + name + "' of node '" + node->getNamePath() + "' has no value");
+        }
+        return createConstant(getValueFloats(defInput->getValue()));
+    }
+
+    TexelBufferPtr evaluateInterfaceInput(const string& name, Scope& scope)
+    {
+        if (scope.instance)
+        {
+            return evaluateNodeInput(scope.instance, nullptr, name, *scope.parent);
+        }
+        InputPtr graphInput = scope.graph->getInput(name);
+        if (!graphInput)
+        {
+            throw Exception("Invalid interface name '" + name + "' in '" + scope.graph->getNamePath() + "'");
+        }
+        return evaluateInputElement(graphInput, scope);
+    }
+
+    TexelBufferPtr evaluateInputElement(InputPtr input, Scope& scope)
+    {
+        if (input->hasInterfaceName())
+        {
+            return evaluateInterfaceInput(input->getInterfaceName(), scope);
+        }
+        if (input->hasNodeName())
+        {
+            GraphElementPtr graph = input->getParent()->getParent()->asA<GraphElement>();
+            NodePtr upstream = graph ? graph->getNode(input->getNodeName()) : nullptr;
+            if (!upstream)
+            {
+                throw Exception("Input '" + input->getNamePath() + "' is connected to an invalid node");
+            }
+            return evaluateNode(upstream, input->getOutputString(), scope);
+        }
+        if (input->hasNodeGraphString())
+        {
+            OutputPtr output = input->getConnectedOutput();
+            if (!output)
+            {
+                throw Exception("Input '" + input->getNamePath() + "' is connected to an invalid output");
+            }
+            Scope child;
+            child.graph = output->getParent()->asA<GraphElement>();
+            child.parent = &scope;
+            return evaluateOutput(output, child);
+        }
+
+        ValuePtr value = input->getValue();
+        if (!value)
+        {
+            throw Exception("Input '" + input->getNamePath() + "' has no value");
+        }
+        vector<float> values = getValueFloats(value);
+        if ((input->getType() == "color3" || input->getType() == "color4") && isSrgbColorSpace(input->getActiveColorSpace(), input->getNamePath()))
+        {
+            for (size_t c = 0; c < 3; c++)
+            {
+                values[c] = srgbToLinear(values[c]);
+            }
+        }
+        return createConstant(values);
+    }
+
+    // Evaluate a uniform string input, such as a file name or an address mode.
+    string evaluateString(NodePtr node, const string& name, Scope& scope, InputPtr* resolvedInput = nullptr)
+    {
+        InputPtr input = node->getInput(name);
+        if (input && input->hasInterfaceName())
+        {
+            if (scope.instance)
+            {
+                return evaluateString(scope.instance, input->getInterfaceName(), *scope.parent, resolvedInput);
+            }
+            input = scope.graph->getInput(input->getInterfaceName());
+        }
+        if (!input)
+        {
+            NodeDefPtr nodeDef = node->getNodeDef(GlslShaderGenerator::TARGET);
+            input = nodeDef ? nodeDef->getActiveInput(name) : nullptr;
+        }
+        if (!input)
+        {
+            return EMPTY_STRING;
+        }
+        if (resolvedInput)
+        {
+            *resolvedInput = input;
+        }
+        return input->getResolvedValueString();
+    }
+
+    TexelBufferPtr evaluateGeomProp(const string& geomProp, unsigned int channels)
+    {
+        if (geomProp == "UV0")
+        {
+            return evaluateTexcoord(channels);
+        }
+        if (geomProp == "Pobject" || geomProp == "Pworld")
+        {
+            return evaluatePosition(channels);
+        }
+        throw Exception("Geometric property '" + geomProp + "' is not supported by the CPU texture baker");
+    }
+
+    TexelBufferPtr evaluateTexcoord(unsigned int channels)
+    {
+        TexelBufferPtr out = createBuffer(channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            Vector2 uv = _tile.getTexcoord(t);
+            for (unsigned int c = 0; c < channels; c++)
+            {
+                out->data[t * channels + c] = c < 2 ? uv[c] : 0.0f;
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evaluatePosition(unsigned int channels)
+    {
+        // Texture space is rendered as a quad spanning [-1, 1] in the XY plane.
+        TexelBufferPtr out = createBuffer(channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            Vector2 uv = _tile.getTexcoord(t);
+            for (unsigned int c = 0; c < channels; c++)
+            {
+                out->data[t * channels + c] = c < 2 ? uv[c] * 2.0f - 1.0f : 0.0f;
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr input(const NodeContext& context, const string& name)
+    {
+        return evaluateNodeInput(context.node, context.nodeDef, name, *context.scope);
+    }
+
+    //
+    // Built-in node implementations
+    //
+
+    static const std::unordered_map<string, Operator>& getOperators()
+    {
+        static const std::unordered_map<string, Operator> operators =
+        {
+            { "constant", &GraphEvaluator::evalPassThrough },
+            { "dot", &GraphEvaluator::evalPassThrough },
+            { "add", &GraphEvaluator::evalBinary },
+            { "subtract", &GraphEvaluator::evalBinary },
+            { "multiply", &GraphEvaluator::evalBinary },
+            { "divide", &GraphEvaluator::evalBinary },
+            { "modulo", &GraphEvaluator::evalBinary },
+            { "power", &GraphEvaluator::evalBinary },
+            { "min", &GraphEvaluator::evalBinary },
+            { "max", &GraphEvaluator::evalBinary },
+            { "atan2", &GraphEvaluator::evalBinary },
+            { "absval", &GraphEvaluator::evalUnary },
+            { "floor", &GraphEvaluator::evalUnary },
+            { "ceil", &GraphEvaluator::evalUnary },
+            { "round", &GraphEvaluator::evalUnary },
+            { "sign", &GraphEvaluator::evalUnary },
+            { "sin", &GraphEvaluator::evalUnary },
+            { "cos", &GraphEvaluator::evalUnary },
+            { "tan", &GraphEvaluator::evalUnary },
+            { "asin", &GraphEvaluator::evalUnary },
+            { "acos", &GraphEvaluator::evalUnary },
+            { "sqrt", &GraphEvaluator::evalUnary },
+            { "ln", &GraphEvaluator::evalUnary },
+            { "exp", &GraphEvaluator::evalUnary },
+            { "invert", &GraphEvaluator::evalInvert },
+            { "clamp", &GraphEvaluator::evalClamp },
+            { "mix", &GraphEvaluator::evalMix },
+            { "remap", &GraphEvaluator::evalRemap },
+            { "smoothstep", &GraphEvaluator::evalSmoothstep },
+            { "normalize", &GraphEvaluator::evalNormalize },
+            { "magnitude", &GraphEvaluator::evalMagnitude },
+            { "dotproduct", &GraphEvaluator::evalDotProduct },
+            { "crossproduct", &GraphEvaluator::evalCrossProduct },
+            { "luminance", &GraphEvaluator::evalLuminance },
+            { "convert", &GraphEvaluator::evalConvert },
+            { "swizzle", &GraphEvaluator::evalSwizzle },
+            { "combine2", &GraphEvaluator::evalCombine },
+            { "combine3", &GraphEvaluator::evalCombine },
+            { "combine4", &GraphEvaluator::evalCombine },
+            { "separate2", &GraphEvaluator::evalSeparate },
+            { "separate3", &GraphEvaluator::evalSeparate },
+            { "separate4", &GraphEvaluator::evalSeparate },
+            { "extract", &GraphEvaluator::evalExtract },
+            { "ifgreater", &GraphEvaluator::evalConditional },
+            { "ifgreatereq", &GraphEvaluator::evalConditional },
+            { "ifequal", &GraphEvaluator::evalConditional },
+            { "texcoord", &GraphEvaluator::evalTexcoord },
+            { "position", &GraphEvaluator::evalPosition },
+            { "image", &GraphEvaluator::evalImage },
+        };
+        return operators;
+    }
+
+    TexelBufferPtr evalPassThrough(const NodeContext& context)
+    {
+        return map1(*input(context, context.node->getCategory() == "constant" ? "value" : "in"), context.channels, [](float a) { return a; });
+    }
+
+    TexelBufferPtr evalUnary(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        const string& category = context.node->getCategory();
+        if (category == "absval")
+            return map1(*in, context.channels, [](float a) { return std::abs(a); });
+        if (category == "floor")
+            return map1(*in, context.channels, [](float a) { return std::floor(a); });
+        if (category == "ceil")
+            return map1(*in, context.channels, [](float a) { return std::ceil(a); });
+        if (category == "round")
+            return map1(*in, context.channels, [](float a) { return std::round(a); });
+        if (category == "sign")
+            return map1(*in, context.channels, [](float a) { return (float) ((a > 0.0f) - (a < 0.0f)); });
+        if (category == "sin")
+            return map1(*in, context.channels, [](float a) { return std::sin(a); });
+        if (category == "cos")
+            return map1(*in, context.channels, [](float a) { return std::cos(a); });
+        if (category == "tan")
+            return map1(*in, context.channels, [](float a) { return std::tan(a); });
+        if (category == "asin")
+            return map1(*in, context.channels, [](float a) { return std::asin(a); });
+        if (category == "acos")
+            return map1(*in, context.channels, [](float a) { return std::acos(a); });
+        if (category == "sqrt")
+            return map1(*in, context.channels, [](float a) { return std::sqrt(a); });
+        if (category == "ln")
+            return map1(*in, context.channels, [](float a) { return std::log(a); });
+        return map1(*in, context.channels, [](float a) { return std::exp(a); });
+    }
+
+    TexelBufferPtr evalBinary(const NodeContext& context)
+    {
+        const string& category = context.node->getCategory();
+        bool namedAtan2 = category == "atan2" && context.nodeDef->getActiveInput("iny");
+        TexelBufferPtr a = input(context, namedAtan2 ? "iny" : "in1");
+        TexelBufferPtr b = input(context, namedAtan2 ? "inx" : "in2");
+        if (category == "add")
+            return map2(*a, *b, context.channels, [](float x, float y) { return x + y; });
+        if (category == "subtract")
+            return map2(*a, *b, context.channels, [](float x, float y) { return x - y; });
+        if (category == "multiply")
+            return map2(*a, *b, context.channels, [](float x, float y) { return x * y; });
+        if (category == "divide")
+            return map2(*a, *b, context.channels, [](float x, float y) { return x / y; });
+        if (category == "modulo")
+            return map2(*a, *b, context.channels, [](float x, float y) { return x - y * std::floor(x / y); });
+        if (category == "power")
+            return map2(*a, *b, context.channels, [](float x, float y) { return std::pow(x, y); });
+        if (category == "min")
+            return map2(*a, *b, context.channels, [](float x, float y) { return std::min(x, y); });
+        if (category == "max")
+            return map2(*a, *b, context.channels, [](float x, float y) { return std::max(x, y); });
+        return map2(*a, *b, context.channels, [](float x, float y) { return std::atan2(x, y); });
+    }
+
+    TexelBufferPtr evalInvert(const NodeContext& context)
+    {
+        return map2(*input(context, "in"), *input(context, "amount"), context.channels, [](float x, float amount) { return amount - x; });
+    }
+
+    TexelBufferPtr evalClamp(const NodeContext& context)
+    {
+        return map3(*input(context, "in"), *input(context, "low"), *input(context, "high"), context.channels,
+                    [](float x, float low, float high) { return std::min(std::max(x, low), high); });
+    }
+
+    TexelBufferPtr evalMix(const NodeContext& context)
+    {
+        return map3(*input(context, "bg"), *input(context, "fg"), *input(context, "mix"), context.channels,
+                    [](float bg, float fg, float amount) { return bg + (fg - bg) * amount; });
+    }
+
+    TexelBufferPtr evalRemap(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        TexelBufferPtr inLow = input(context, "inlow");
+        TexelBufferPtr inHigh = input(context, "inhigh");
+        TexelBufferPtr outLow = input(context, "outlow");
+        TexelBufferPtr outHigh = input(context, "outhigh");
+        TexelBufferPtr out = createBuffer(context.channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            for (unsigned int c = 0; c < context.channels; c++)
+            {
+                float low = inLow->get(t, c);
+                out->data[t * context.channels + c] = outLow->get(t, c) + (in->get(t, c) - low) * (outHigh->get(t, c) - outLow->get(t, c)) / (inHigh->get(t, c) - low);
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalSmoothstep(const NodeContext& context)
+    {
+        return map3(*input(context, "in"), *input(context, "low"), *input(context, "high"), context.channels,
+                    [](float x, float low, float high)
+                    {
+                        if (x >= high)
+                            return 1.0f;
+                        if (x <= low)
+                            return 0.0f;
+                        float t = (x - low) / (high - low);
+                        return t * t * (3.0f - 2.0f * t);
+                    });
+    }
+
+    TexelBufferPtr evalNormalize(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        TexelBufferPtr out = createBuffer(context.channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            float length = 0.0f;
+            for (unsigned int c = 0; c < context.channels; c++)
+            {
+                length += in->get(t, c) * in->get(t, c);
+            }
+            length = std::sqrt(length);
+            for (unsigned int c = 0; c < context.channels; c++)
+            {
+                out->data[t * context.channels + c] = in->get(t, c) / length;
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalMagnitude(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        TexelBufferPtr out = createBuffer(1);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            float length = 0.0f;
+            for (unsigned int c = 0; c < in->channels; c++)
+            {
+                length += in->get(t, c) * in->get(t, c);
+            }
+            out->data[t] = std::sqrt(length);
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalDotProduct(const NodeContext& context)
+    {
+        TexelBufferPtr a = input(context, "in1");
+        TexelBufferPtr b = input(context, "in2");
+        TexelBufferPtr out = createBuffer(1);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            float sum = 0.0f;
+            for (unsigned int c = 0; c < a->channels; c++)
+            {
+                sum += a->get(t, c) * b->get(t, c);
+            }
+            out->data[t] = sum;
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalCrossProduct(const NodeContext& context)
+    {
+        TexelBufferPtr a = input(context, "in1");
+        TexelBufferPtr b = input(context, "in2");
+        TexelBufferPtr out = createBuffer(3);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            float* dst = &out->data[t * 3];
+            dst[0] = a->get(t, 1) * b->get(t, 2) - a->get(t, 2) * b->get(t, 1);
+            dst[1] = a->get(t, 2) * b->get(t, 0) - a->get(t, 0) * b->get(t, 2);
+            dst[2] = a->get(t, 0) * b->get(t, 1) - a->get(t, 1) * b->get(t, 0);
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalLuminance(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        TexelBufferPtr coeffs = input(context, "lumacoeffs");
+        TexelBufferPtr out = createBuffer(context.channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            float luma = in->get(t, 0) * coeffs->get(t, 0) + in->get(t, 1) * coeffs->get(t, 1) + in->get(t, 2) * coeffs->get(t, 2);
+            for (unsigned int c = 0; c < context.channels; c++)
+            {
+                out->data[t * context.channels + c] = c < 3 ? luma : in->get(t, c);
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalConvert(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        if (in->channels == 1)
+        {
+            return map1(*in, context.channels, [](float a) { return a; });
+        }
+        TexelBufferPtr out = createBuffer(context.channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            for (unsigned int c = 0; c < context.channels; c++)
+            {
+                // Missing channels are zero, except for an opaque alpha.
+                out->data[t * context.channels + c] = c < in->channels ? in->get(t, c) : (c == 3 ? 1.0f : 0.0f);
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalSwizzle(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        const string channels = evaluateString(context.node, "channels", *context.scope);
+        TexelBufferPtr out = createBuffer(context.channels);
+        for (unsigned int c = 0; c < context.channels; c++)
+        {
+            char channel = c < channels.size() ? channels[c] : '0';
+            const string names[2] = { "xyzw", "rgba" };
+            size_t index = names[0].find(channel);
+            if (index == string::npos)
+            {
+                index = names[1].find(channel);
+            }
+            for (size_t t = 0; t < _texelCount; t++)
+            {
+                float value = channel == '1' ? 1.0f : 0.0f;
+                if (index != string::npos && (in->channels == 1 || index < in->channels))
+                {
+                    value = in->get(t, (unsigned int) index);
+                }
+                out->data[t * context.channels + c] = value;
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalCombine(const NodeContext& context)
+    {
+        TexelBufferPtr out = createBuffer(context.channels);
+        unsigned int channel = 0;
+        for (unsigned int i = 1; i <= 4 && channel < context.channels; i++)
+        {
+            TexelBufferPtr in = input(context, "in" + std::to_string(i));
+            for (unsigned int c = 0; c < in->channels && channel < context.channels; c++, channel++)
+            {
+                for (size_t t = 0; t < _texelCount; t++)
+                {
+                    out->data[t * context.channels + channel] = in->get(t, c);
+                }
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalSeparate(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        const char channelName = context.output.back();
+        size_t index = string("xyzw").find(channelName);
+        if (index == string::npos)
+        {
+            index = string("rgba").find(channelName);
+        }
+        if (index == string::npos)
+        {
+            throw Exception("Invalid output '" + context.output + "' of node '" + context.node->getNamePath() + "'");
+        }
+        TexelBufferPtr out = createBuffer(1);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            out->data[t] = in->get(t, (unsigned int) index);
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalExtract(const NodeContext& context)
+    {
+        TexelBufferPtr in = input(context, "in");
+        TexelBufferPtr index = input(context, "index");
+        TexelBufferPtr out = createBuffer(1);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            unsigned int channel = (unsigned int) std::min(std::max(index->get(t, 0), 0.0f), (float) (in->channels - 1));
+            out->data[t] = in->get(t, channel);
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalConditional(const NodeContext& context)
+    {
+        TexelBufferPtr value1 = input(context, "value1");
+        TexelBufferPtr value2 = input(context, "value2");
+        TexelBufferPtr in1 = input(context, "in1");
+        TexelBufferPtr in2 = input(context, "in2");
+        const string& category = context.node->getCategory();
+        TexelBufferPtr out = createBuffer(context.channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            float a = value1->get(t, 0);
+            float b = value2->get(t, 0);
+            bool condition = category == "ifgreater" ? a > b : (category == "ifgreatereq" ? a >= b : a == b);
+            const TexelBuffer& selected = condition ? *in1 : *in2;
+            for (unsigned int c = 0; c < context.channels; c++)
+            {
+                out->data[t * context.channels + c] = selected.get(t, c);
+            }
+        }
+        return out;
+    }
+
+    TexelBufferPtr evalTexcoord(const NodeContext& context)
+    {
+        return evaluateTexcoord(context.channels);
+    }
+
+    TexelBufferPtr evalPosition(const NodeContext& context)
+    {
+        return evaluatePosition(context.channels);
+    }
+
+    static int addressTexel(int texel, int size, const string& mode)
+    {
+        if (mode == "periodic")
+        {
+            return ((texel % size) + size) % size;
+        }
+        if (mode == "mirror")
+        {
+            int period = ((texel % (2 * size)) + 2 * size) % (2 * size);
+            return period < size ? period : 2 * size - 1 - period;
+        }
+        return std::min(std::max(texel, 0), size - 1);
+    }
+
+    TexelBufferPtr evalImage(const NodeContext& context)
+    {
+        InputPtr fileInput;
+        const string filename = evaluateString(context.node, "file", *context.scope, &fileInput);
+        const string uMode = evaluateString(context.node, "uaddressmode", *context.scope);
+        const string vMode = evaluateString(context.node, "vaddressmode", *context.scope);
+        const bool closest = evaluateString(context.node, "filtertype", *context.scope) == "closest";
+        TexelBufferPtr defaultValue = input(context, "default");
+        TexelBufferPtr texcoord = input(context, "texcoord");
+
+        ImagePtr image = filename.empty() ? nullptr : _images.acquire(filename);
+        if (!image || !image->getResourceBuffer())
+        {
+            return map1(*defaultValue, context.channels, [](float a) { return a; });
+        }
+        // As with the color management system, only color images are transformed.
+        const string& type = context.node->getType();
+        const bool linearize = fileInput && (type == "color3" || type == "color4") &&
+                               isSrgbColorSpace(fileInput->getActiveColorSpace(), fileInput->getNamePath());
+        const int width = (int) image->getWidth();
+        const int height = (int) image->getHeight();
+
+        TexelBufferPtr out = createBuffer(context.channels);
+        for (size_t t = 0; t < _texelCount; t++)
+        {
+            float u = texcoord->get(t, 0);
+            float v = texcoord->get(t, 1);
+            float* dst = &out->data[t * context.channels];
+            if ((uMode == "constant" && (u < 0.0f || u > 1.0f)) || (vMode == "constant" && (v < 0.0f || v > 1.0f)))
+            {
+                for (unsigned int c = 0; c < context.channels; c++)
+                {
+                    dst[c] = defaultValue->get(t, c);
+                }
+                continue;
+            }
+
+            // Images are stored top row first, as with vertically flipped lookups in GLSL.
+            float x = u * width - 0.5f;
+            float y = (1.0f - v) * height - 0.5f;
+            Color4 color;
+            if (closest)
+            {
+                color = image->getTexelColor(addressTexel((int) std::floor(x + 0.5f), width, uMode),
+                                             addressTexel((int) std::floor(y + 0.5f), height, vMode));
+            }
+            else
+            {
+                int x0 = (int) std::floor(x);
+                int y0 = (int) std::floor(y);
+                float fx = x - x0;
+                float fy = y - y0;
+                unsigned int ax0 = addressTexel(x0, width, uMode);
+                unsigned int ax1 = addressTexel(x0 + 1, width, uMode);
+                unsigned int ay0 = addressTexel(y0, height, vMode);
+                unsigned int ay1 = addressTexel(y0 + 1, height, vMode);
+                Color4 top = image->getTexelColor(ax0, ay0) * (1.0f - fx) + image->getTexelColor(ax1, ay0) * fx;
+                Color4 bottom = image->getTexelColor(ax0, ay1) * (1.0f - fx) + image->getTexelColor(ax1, ay1) * fx;
+                color = top * (1.0f - fy) + bottom * fy;
+            }
+            for (unsigned int c = 0; c < context.channels; c++)
+            {
+                dst[c] = (linearize && c < 3) ? srgbToLinear(color[c]) : color[c];
+            }
+        }
+        return out;
+    }
+
+  private:
+    const Tile& _tile;
+    ImageCache& _images;
+    size_t _texelCount;
+    std::unordered_map<GraphElementPtr, Scope> _graphScopes;
+};
+
+} // anonymous namespace
+
+CpuTextureBaker::CpuTextureBaker(unsigned int width, unsigned int height, Image::BaseType baseType) :
+    TextureBaker(width, height, baseType, false),
+    _threadCount(std::max(std::thread::hardware_concurrency(), 1u))
+{
+}
+
+void CpuTextureBaker::bakeGraphOutput(OutputPtr output, GenContext& context, const StringMap& filenameTemplateMap)
+{
+    bakeGraphOutputs({ output }, context, { filenameTemplateMap });
+}
+
+void CpuTextureBaker::bakeGraphOutputs(const vector<OutputPtr>& outputs, GenContext&, const vector<StringMap>& filenameTemplateMaps)
+{
+    if (outputs.size() != filenameTemplateMaps.size())
+    {
+        throw Exception("Mismatched output and filename template counts in texture baking");
+    }
+    if (_colorSpace != SRGB_TEXTURE && _colorSpace != LIN_REC709)
+    {
+        throw Exception("Color space '" + _colorSpace + "' is not supported by the CPU texture baker");
+    }
+
+    // Each output is captured to its own image, the first one being the frame capture image.
+    vector<OutputPtr> bakedOutputs;
+    vector<StringMap> bakedTemplateMaps;
+    vector<ImagePtr> images;
+    vector<bool> encodeSrgb;
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        if (!outputs[i])
+        {
+            continue;
+        }
+        ImagePtr image = _frameCaptureImage;
+        if (!images.empty())
+        {
+            image = Image::create(_width, _height, 4, _baseType);
+            image->createResourceBuffer();
+        }
+        bakedOutputs.push_back(outputs[i]);
+        bakedTemplateMaps.push_back(filenameTemplateMaps[i]);
+        images.push_back(image);
+        encodeSrgb.push_back(_colorSpace == SRGB_TEXTURE &&
+            (outputs[i]->getType() == "color3" || outputs[i]->getType() == "color4"));
+    }
+    if (bakedOutputs.empty())
+    {
+        return;
+    }
+    const bool clampOutput = _baseType != Image::BaseType::FLOAT && _baseType != Image::BaseType::HALF;
+
+    vector<Tile> tiles;
+    for (unsigned int y = 0; y < _height; y += TILE_SIZE)
+    {
+        for (unsigned int x = 0; x < _width; x += TILE_SIZE)
+        {
+            Tile tile;
+            tile.x = x;
+            tile.y = y;
+            tile.width = std::min(TILE_SIZE, _width - x);
+            tile.height = std::min(TILE_SIZE, _height - y);
+            tile.imageWidth = _width;
+            tile.imageHeight = _height;
+            tiles.push_back(tile);
+        }
+    }
+
+    ScopedTimer renderTimer(&_statistics.renderTime);
+    ImageCache imageCache(_imageHandler);
+    std::atomic<size_t> nextTile(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto bakeTiles = [&]()
+    {
+        try
+        {
+            for (size_t i = nextTile++; i < tiles.size(); i = nextTile++)
+            {
+                const Tile& tile = tiles[i];
+                GraphEvaluator evaluator(tile, imageCache);
+                for (size_t o = 0; o < bakedOutputs.size(); o++)
+                {
+                    TexelBufferPtr result = evaluator.evaluate(bakedOutputs[o]);
+                    for (size_t t = 0; t < tile.getTexelCount(); t++)
+                    {
+                        // Match the conversion of the final output to a vec4 in GLSL.
+                        Color4 color(0.0f, 0.0f, 0.0f, 1.0f);
+                        for (unsigned int c = 0; c < 4; c++)
+                        {
+                            if (result->channels == 1)
+                            {
+                                color[c] = c < 3 ? result->get(t, 0) : 1.0f;
+                            }
+                            else if (c < result->channels)
+                            {
+                                color[c] = result->get(t, c);
+                            }
+                        }
+                        for (unsigned int c = 0; c < 4; c++)
+                        {
+                            if (encodeSrgb[o] && c < 3)
+                            {
+                                color[c] = linearToSrgb(std::max(color[c], 0.0f));
+                            }
+                            if (clampOutput)
+                            {
+                                color[c] = std::min(std::max(color[c], 0.0f), 1.0f);
+                            }
+                        }
+                        images[o]->setTexelColor(tile.x + (unsigned int) (t % tile.width), tile.y + (unsigned int) (t / tile.width), color);
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            nextTile = tiles.size();
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(std::max(_threadCount, 1u), tiles.size());
+    vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++)
+    {
+        threads.emplace_back(bakeTiles);
+    }
+    bakeTiles();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    renderTimer.endTimer();
+    _statistics.renderCount++;
+
+    ImagePtr frameCaptureImage = _frameCaptureImage;
+    for (size_t o = 0; o < bakedOutputs.size(); o++)
+    {
+        _frameCaptureImage = images[o];
+        storeBakedImage(bakedOutputs[o], bakedTemplateMaps[o]);
+    }
+    _frameCaptureImage = frameCaptureImage;
+}
+
+MATERIALX_NAMESPACE_END
@@ -0,0 +1,73 @@
+//
+// TM & (c) 2019 Lucasfilm Entertainment Company Ltd. and Lucasfilm Ltd.
+// All rights reserved.  See LICENSE.txt for license.
+//
+
+#ifndef MATERIALX_CPUTEXTUREBAKER
+#define MATERIALX_CPUTEXTUREBAKER
+
+/// @file
+/// Texture baking on the CPU
+
+#include <MaterialXRenderGlsl/TextureBaker.h>
+
+MATERIALX_NAMESPACE_BEGIN
+
+/// A shared pointer to a CpuTextureBaker
+using CpuTextureBakerPtr = shared_ptr<class CpuTextureBaker>;
+
+/// @class CpuTextureBaker
+/// A texture baker that evaluates node graphs on the CPU instead of rendering
+/// them with OpenGL, for hosts without a GPU.
+///
+/// The baked image is split into tiles that are evaluated in parallel, and each
+/// node of the graph is evaluated over all texels of a tile at once.  All
+/// baked inputs of a material are evaluated in the same pass, so nodes they
+/// share upstream are evaluated only once per tile.  Documents
+/// and images are produced exactly as by TextureBaker.  Nodes are evaluated with
+/// built-in implementations of the standard library operators, image lookups and
+/// texture coordinates, and through their node graph implementations otherwise.
+/// Colors are read and written in the srgb_texture and lin_rec709 color spaces.
+/// Baking a graph containing any other node or color space throws an exception.
+class MX_RENDERGLSL_API CpuTextureBaker : public TextureBaker
+{
+  public:
+    static CpuTextureBakerPtr create(unsigned int width = 1024, unsigned int height = 1024, Image::BaseType baseType = Image::BaseType::UINT8)
+    {
+        return CpuTextureBakerPtr(new CpuTextureBaker(width, height, baseType));
+    }
+
+    /// Set the number of threads used to evaluate tiles.  Defaults to the number
+    /// of hardware threads.
+    void setThreadCount(unsigned int threadCount)
+    {
+        _threadCount = threadCount;
+    }
+
+    /// Return the number of threads used to evaluate tiles.
+    unsigned int getThreadCount() const
+    {
+        return _threadCount;
+    }
+
+    /// Bake a texture for the given graph output.
+    void bakeGraphOutput(OutputPtr output, GenContext& context, const StringMap& filenameTemplateMap) override;
+
+    /// Bake textures for several graph outputs in a single pass.
+    void bakeGraphOutputs(const vector<OutputPtr>& outputs, GenContext& context, const vector<StringMap>& filenameTemplateMaps) override;
+
+  protected:
+    CpuTextureBaker(unsigned int width, unsigned int height, Image::BaseType baseType);
+
+    string getBackendName() const override
+    {
+        return "cpu";
+    }
+
+  protected:
+    unsigned int _threadCount;
+};
+
+MATERIALX_NAMESPACE_END
+
+#endif
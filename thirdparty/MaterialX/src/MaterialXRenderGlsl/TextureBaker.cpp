@@ -7,12 +7,20 @@
 
 #include <MaterialXRender/OiioImageLoader.h>
 #include <MaterialXRender/StbImageLoader.h>
+#include <MaterialXRender/Timer.h>
 #include <MaterialXRender/Util.h>
 
 #include <MaterialXGenShader/DefaultColorManagementSystem.h>
 
 #include <MaterialXFormat/XmlIo.h>
 
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
 MATERIALX_NAMESPACE_BEGIN
 
 namespace {
@@ -44,9 +52,232 @@ string getValueStringFromColor(const Color4& color, const string& type)
     return EMPTY_STRING;
 }
 
+// 64-bit FNV-1a, continuing from the given hash.
+uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+string hashString(const string& str)
+{
+    std::ostringstream hex;
+    hex << std::hex << std::setfill('0') << std::setw(16)
+        << hashBytes(reinterpret_cast<const unsigned char*>(str.data()), str.size());
+    return hex.str();
+}
+
+// SHA-256 digest of a buffer as a hexadecimal string.  Images stored by content
+// are identified by it alone, so a weaker hash could let two images collide.
+string sha256Hex(const unsigned char* data, size_t size)
+{
+    static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    auto rotate = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+    // The message is followed by a one bit, zeros, and its length in bits.
+    const size_t paddedSize = ((size + 8) / 64 + 1) * 64;
+    unsigned char block[64];
+    for (size_t offset = 0; offset < paddedSize; offset += 64)
+    {
+        for (size_t i = 0; i < 64; i++)
+        {
+            size_t pos = offset + i;
+            if (pos < size)
+                block[i] = data[pos];
+            else if (pos == size)
+                block[i] = 0x80;
+            else if (pos >= paddedSize - 8)
+                block[i] = (unsigned char) ((uint64_t) size * 8 >> (8 * (paddedSize - 1 - pos)));
+            else
+                block[i] = 0;
+        }
+
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (uint32_t) block[4 * i] << 24 | (uint32_t) block[4 * i + 1] << 16 | (uint32_t) block[4 * i + 2] << 8 | block[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t t1 = k + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            k = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += k;
+    }
+
+    std::ostringstream hex;
+    hex << std::hex << std::setfill('0');
+    for (uint32_t word : h)
+    {
+        hex << std::setw(8) << word;
+    }
+    return hex.str();
+}
+
+// Return a name, unique across threads and processes, under which a file is
+// written before being moved to the given path.  The extension is kept.
+FilePath getTemporaryPath(FilePath path)
+{
+    static std::atomic<unsigned int> counter(0);
+    static const unsigned int processId = std::random_device()();
+    const string extension = path.getExtension();
+    path.removeExtension();
+    std::ostringstream name;
+    name << path.asString() << ".tmp" << std::hex << processId << "_" << counter++ << "." << extension;
+    return FilePath(name.str());
+}
+
+// Move a temporary file to its final path, returning true if the path then
+// holds a complete file.  Renaming onto an existing file fails on some
+// platforms, in which case the existing file is removed first; if another
+// writer recreates it meanwhile, its file is kept.
+bool moveTemporaryFile(const FilePath& temporaryPath, const FilePath& path)
+{
+    if (std::rename(temporaryPath.asString().c_str(), path.asString().c_str()) == 0)
+    {
+        return true;
+    }
+    std::remove(path.asString().c_str());
+    if (std::rename(temporaryPath.asString().c_str(), path.asString().c_str()) == 0)
+    {
+        return true;
+    }
+    std::remove(temporaryPath.asString().c_str());
+    return path.exists();
+}
+
+// The files read by a graph, which are resolved on different search paths.
+struct UpstreamFiles
+{
+    StringSet images;
+    StringSet sources;
+};
+
+// Serialize an element and everything upstream of it, naming elements by the
+// order in which they are visited, and collect the files the graph reads.
+// Nodes are followed into their implementations for the given target.
+int serializeUpstream(ElementPtr elem, const string& target, std::unordered_map<ElementPtr, int>& ids, string& content, UpstreamFiles& files)
+{
+    if (!elem)
+    {
+        return -1;
+    }
+    auto found = ids.find(elem);
+    if (found != ids.end())
+    {
+        return found->second;
+    }
+    int id = (int) ids.size();
+    ids[elem] = id;
+
+    string line = std::to_string(id) + " " + elem->getCategory();
+    if (TypedElementPtr typed = elem->asA<TypedElement>())
+    {
+        line += " " + typed->getType();
+    }
+    if (InputPtr input = elem->asA<Input>())
+    {
+        line += " " + input->getName() + " " + input->getActiveColorSpace() + " " + input->getUnit() + " " + input->getUnitType() + " " + input->getOutputString();
+        if (input->getType() == FILENAME_TYPE_STRING)
+        {
+            // Files are keyed by their content rather than their path.
+            string file = input->getResolvedValueString();
+            if (!file.empty())
+            {
+                files.images.insert(file);
+            }
+            line += " " + file;
+        }
+        else
+        {
+            line += " " + input->getValueString();
+        }
+        line += " " + std::to_string(serializeUpstream(input->getInterfaceInput(), target, ids, content, files));
+        line += " " + std::to_string(serializeUpstream(input->getConnectedOutput(), target, ids, content, files));
+        line += " " + std::to_string(serializeUpstream(input->getConnectedNode(), target, ids, content, files));
+    }
+    else if (OutputPtr output = elem->asA<Output>())
+    {
+        line += " " + output->getOutputString();
+        line += " " + std::to_string(serializeUpstream(output->getConnectedNode(), target, ids, content, files));
+        InterfaceElementPtr graph = output->getParent()->asA<InterfaceElement>();
+        if (graph && output->hasInterfaceName())
+        {
+            line += " " + std::to_string(serializeUpstream(graph->getInput(output->getInterfaceName()), target, ids, content, files));
+        }
+    }
+    else if (NodePtr node = elem->asA<Node>())
+    {
+        // Definitions and implementations may be custom, or edited along with the document.
+        NodeDefPtr nodeDef = node->getNodeDef();
+        line += " " + std::to_string(serializeUpstream(nodeDef, target, ids, content, files));
+        line += " " + std::to_string(serializeUpstream(nodeDef ? nodeDef->getImplementation(target) : nullptr, target, ids, content, files));
+        for (ElementPtr child : node->getChildren())
+        {
+            line += " " + std::to_string(serializeUpstream(child, target, ids, content, files));
+        }
+    }
+    else if (ImplementationPtr implementation = elem->asA<Implementation>())
+    {
+        line += " " + implementation->getName() + " " + implementation->getFile() + " " + implementation->getFunction() +
+                " " + implementation->getAttribute("sourcecode");
+        if (implementation->hasFile())
+        {
+            files.sources.insert(implementation->getFile());
+        }
+    }
+    else if (elem->isA<InterfaceElement>())
+    {
+        // Node definitions and node graphs, along with their ports and nodes.
+        line += " " + elem->getName();
+        for (ElementPtr child : elem->getChildren())
+        {
+            line += " " + std::to_string(serializeUpstream(child, target, ids, content, files));
+        }
+    }
+    content += line + "\n";
+    return id;
+}
+
 } // anonymous namespace
 
-TextureBaker::TextureBaker(unsigned int width, unsigned int height, Image::BaseType baseType) :
+TextureBaker::TextureBaker(unsigned int width, unsigned int height, Image::BaseType baseType, bool initializeRenderer) :
     GlslRenderer(width, height, baseType),
     _distanceUnit("meter"),
     _averageImages(false),
@@ -78,11 +309,16 @@ TextureBaker::TextureBaker(unsigned int width, unsigned int height, Image::BaseT
         _colorSpace = LIN_REC709;
     }
 
-    // Initialize our base renderer.
-    initialize();
-
-    // Initialize our image handler.
-    _imageHandler = GLTextureHandler::create(StbImageLoader::create());
+    // Initialize our base renderer and image handler.
+    if (initializeRenderer)
+    {
+        initialize();
+        _imageHandler = GLTextureHandler::create(StbImageLoader::create());
+    }
+    else
+    {
+        _imageHandler = ImageHandler::create(StbImageLoader::create());
+    }
 #if MATERIALX_BUILD_OIIO
     _imageHandler->addLoader(OiioImageLoader::create());
 #endif
@@ -142,8 +378,13 @@ StringMap TextureBaker::initializeFileTemplateMap(InputPtr input, NodePtr shader
 
 bool TextureBaker::writeBakedImage(const BakedImage& baked, ImagePtr image)
 {
-    if (!_imageHandler->saveImage(baked.filename, image, true))
+    ScopedTimer writeTimer(&_statistics.imageWriteTime);
+    _statistics.imageWriteCount++;
+    // Images stored by content may be read by other bakers as soon as they exist.
+    const FilePath temporaryPath = getTemporaryPath(baked.filename);
+    if (!_imageHandler->saveImage(temporaryPath, image, true) || !moveTemporaryFile(temporaryPath, baked.filename))
     {
+        std::remove(temporaryPath.asString().c_str());
         if (_outputStream)
         {
             *_outputStream << "Failed to write baked image: " << baked.filename.asString() << std::endl;
@@ -169,6 +410,8 @@ void TextureBaker::bakeShaderInputs(NodePtr material, NodePtr shader, GenContext
     }
 
     std::unordered_map<OutputPtr, InputPtr> bakedOutputMap;
+    vector<OutputPtr> bakedOutputs;
+    vector<StringMap> filenameTemplateMaps;
     for (InputPtr input : shader->getInputs())
     {
         OutputPtr output = input->getConnectedOutput();
@@ -184,8 +427,8 @@ void TextureBaker::bakeShaderInputs(NodePtr material, NodePtr shader, GenContext
                 output->setConnectedNode(worldSpaceNode->getConnectedNode("in"));
                 _worldSpaceNodes[input->getName()] = worldSpaceNode;
             }
-            StringMap filenameTemplateMap = initializeFileTemplateMap(input, shader, udim);
-            bakeGraphOutput(output, context, filenameTemplateMap);
+            bakedOutputs.push_back(output);
+            filenameTemplateMaps.push_back(initializeFileTemplateMap(input, shader, udim));
         }
         else if (bakedOutputMap.count(output))
         {
@@ -194,10 +437,51 @@ void TextureBaker::bakeShaderInputs(NodePtr material, NodePtr shader, GenContext
         }
     }
 
+    // Reuse cached results, and bake the remaining outputs.
+    vector<OutputPtr> missedOutputs;
+    vector<StringMap> missedTemplateMaps;
+    vector<string> missedKeys;
+    for (size_t i = 0; i < bakedOutputs.size(); i++)
+    {
+        string key = (!_bakeCachePath.isEmpty() && udim.empty()) ? getBakeCacheKey(bakedOutputs[i], context) : EMPTY_STRING;
+        if (!key.empty())
+        {
+            if (readBakeCache(key, bakedOutputs[i], filenameTemplateMaps[i]))
+            {
+                _statistics.cacheHitCount++;
+                continue;
+            }
+            _statistics.cacheMissCount++;
+        }
+        missedOutputs.push_back(bakedOutputs[i]);
+        missedTemplateMaps.push_back(filenameTemplateMaps[i]);
+        missedKeys.push_back(key);
+    }
+    bakeGraphOutputs(missedOutputs, context, missedTemplateMaps);
+    for (size_t i = 0; i < missedOutputs.size(); i++)
+    {
+        if (!missedKeys[i].empty())
+        {
+            writeBakeCache(missedKeys[i], missedOutputs[i]);
+        }
+    }
+
     // Release all images used to generate this set of shader inputs.
     _imageHandler->clearImageCache();
 }
 
+void TextureBaker::bakeGraphOutputs(const vector<OutputPtr>& outputs, GenContext& context, const vector<StringMap>& filenameTemplateMaps)
+{
+    if (outputs.size() != filenameTemplateMaps.size())
+    {
+        throw Exception("Mismatched output and filename template counts in texture baking");
+    }
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        bakeGraphOutput(outputs[i], context, filenameTemplateMaps[i]);
+    }
+}
+
 void TextureBaker::bakeGraphOutput(OutputPtr output, GenContext& context, const StringMap& filenameTemplateMap)
 {
     if (!output)
@@ -205,7 +489,14 @@ void TextureBaker::bakeGraphOutput(OutputPtr output, GenContext& context, const
         return;
     }
 
-    ShaderPtr shader = _generator->generate("BakingShader", output, context);
+    ShaderPtr shader;
+    {
+        ScopedTimer generationTimer(&_statistics.generationTime);
+        shader = _generator->generate("BakingShader", output, context);
+        _statistics.generationCount++;
+    }
+
+    ScopedTimer renderTimer(&_statistics.renderTime);
     createProgram(shader);
 
     bool encodeSrgb = _colorSpace == SRGB_TEXTURE &&
@@ -214,12 +505,18 @@ void TextureBaker::bakeGraphOutput(OutputPtr output, GenContext& context, const
 
     // Render and capture the requested image.
     renderTextureSpace();
-    string texturefilepath = generateTextureFilename(filenameTemplateMap);
     captureImage(_frameCaptureImage);
+    renderTimer.endTimer();
+    _statistics.renderCount++;
+
+    storeBakedImage(output, filenameTemplateMap);
+}
 
+void TextureBaker::storeBakedImage(OutputPtr output, const StringMap& filenameTemplateMap)
+{
     // Construct a baked image record.
     BakedImage baked;
-    baked.filename = texturefilepath;
+    baked.filename = generateTextureFilename(filenameTemplateMap);
     if (_averageImages)
     {
         baked.uniformColor = _frameCaptureImage->getAverageColor();
@@ -229,16 +526,161 @@ void TextureBaker::bakeGraphOutput(OutputPtr output, GenContext& context, const
     {
         baked.isUniform = true;
     }
+    // Store non-uniform images by content when requested, writing each one once.
+    auto udim = filenameTemplateMap.find("$UDIM");
+    bool storeByContent = !baked.isUniform && !_contentImagePath.isEmpty() &&
+                          (udim == filenameTemplateMap.end() || udim->second.empty());
+    if (storeByContent)
+    {
+        if (!_contentImagePath.exists())
+        {
+            _contentImagePath.createDirectory();
+        }
+        baked.filename = _contentImagePath / (getImageContentHash(_frameCaptureImage) + "." + _extension);
+    }
     _bakedImageMap[output].push_back(baked);
 
     // TODO: Write images to memory rather than to disk.
     // Write non-uniform images to disk.
-    if (!baked.isUniform)
+    if (!baked.isUniform && !(storeByContent && baked.filename.exists()))
     {
         writeBakedImage(baked, _frameCaptureImage);
     }
 }
 
+string TextureBaker::getImageContentHash(ImagePtr image)
+{
+    // SHA-256 of the pixels, qualified by the image layout.
+    const unsigned char* data = static_cast<const unsigned char*>(image->getResourceBuffer());
+    std::ostringstream name;
+    name << sha256Hex(data, (size_t) image->getRowStride() * image->getHeight())
+         << "_" << image->getWidth() << "x" << image->getHeight() << "x" << image->getChannelCount()
+         << "_" << (int) image->getBaseType();
+    return name.str();
+}
+
+string TextureBaker::getBakeCacheKey(OutputPtr output, const GenContext& context)
+{
+    std::unordered_map<ElementPtr, int> ids;
+    UpstreamFiles files;
+    string content = _bakeCacheSalt + "\n" + getBackendName() + " " +
+                     std::to_string(_width) + "x" + std::to_string(_height) + " " + std::to_string((int) _baseType) + " " +
+                     _colorSpace + " " + _distanceUnit + " " + _extension + " " + std::to_string(_averageImages) + "\n";
+    serializeUpstream(output, _generator->getTarget(), ids, content, files);
+
+    // Images are found on the image search path, and implementation files on
+    // the source code search path, rooted at the libraries folder.
+    for (const string& file : files.images)
+    {
+        content += file + " " + getFileContentHash(_imageHandler->getSearchPath().find(file)) + "\n";
+    }
+    for (const string& file : files.sources)
+    {
+        content += file + " " + getFileContentHash(context.resolveSourceFile(file)) + "\n";
+    }
+    return hashString(content);
+}
+
+const string& TextureBaker::getFileContentHash(const FilePath& path)
+{
+    auto found = _fileContentHashes.find(path.asString());
+    if (found == _fileContentHashes.end())
+    {
+        string hash = "missing";
+        std::ifstream stream(path.asString(), std::ios::binary);
+        if (stream)
+        {
+            std::ostringstream bytes;
+            bytes << stream.rdbuf();
+            hash = hashString(bytes.str());
+        }
+        found = _fileContentHashes.emplace(path.asString(), hash).first;
+    }
+    return found->second;
+}
+
+bool TextureBaker::readBakeCache(const string& key, OutputPtr output, const StringMap& filenameTemplateMap)
+{
+    std::ifstream stream((_bakeCachePath / (key + ".txt")).asString());
+    string kind;
+    if (!(stream >> kind))
+    {
+        return false;
+    }
+
+    BakedImage baked;
+    baked.filename = generateTextureFilename(filenameTemplateMap);
+    if (kind == "uniform")
+    {
+        for (size_t i = 0; i < 4; i++)
+        {
+            if (!(stream >> baked.uniformColor[i]))
+            {
+                return false;
+            }
+        }
+        baked.isUniform = true;
+    }
+    else if (kind == "image")
+    {
+        // Only images stored by content outlive the bake that wrote them.
+        string filename;
+        std::getline(stream >> std::ws, filename);
+        if (_contentImagePath.isEmpty() || filename.empty() || !FilePath(filename).exists())
+        {
+            return false;
+        }
+        baked.filename = filename;
+    }
+    else
+    {
+        return false;
+    }
+    _bakedImageMap[output].push_back(baked);
+    return true;
+}
+
+void TextureBaker::writeBakeCache(const string& key, OutputPtr output)
+{
+    auto found = _bakedImageMap.find(output);
+    if (found == _bakedImageMap.end() || found->second.empty())
+    {
+        return;
+    }
+    const BakedImage& baked = found->second.back();
+    if (!baked.isUniform && (_contentImagePath.isEmpty() || baked.filename.getParentPath() != _contentImagePath))
+    {
+        return;
+    }
+
+    if (!_bakeCachePath.exists())
+    {
+        _bakeCachePath.createDirectory();
+    }
+    // Other bakers may read the entry while it is written.
+    const FilePath path = _bakeCachePath / (key + ".txt");
+    const FilePath temporaryPath = getTemporaryPath(path);
+    {
+        std::ofstream stream(temporaryPath.asString());
+        if (baked.isUniform)
+        {
+            stream << std::setprecision(9) << "uniform " << baked.uniformColor[0] << " " << baked.uniformColor[1] << " "
+                   << baked.uniformColor[2] << " " << baked.uniformColor[3] << std::endl;
+        }
+        else
+        {
+            stream << "image " << baked.filename.asString() << std::endl;
+        }
+        if (!stream)
+        {
+            stream.close();
+            std::remove(temporaryPath.asString().c_str());
+            return;
+        }
+    }
+    moveTemporaryFile(temporaryPath, path);
+}
+
 void TextureBaker::optimizeBakedTextures(NodePtr shader)
 {
     if (!shader)
@@ -402,7 +844,13 @@ DocumentPtr TextureBaker::generateNewDocumentFromShader(NodePtr shader, const St
                 NodePtr bakedImage = bakedNodeGraph->addNode("image", sourceName + BAKED_POSTFIX, sourceType);
                 InputPtr input = bakedImage->addInput("file", "filename");
                 StringMap filenameTemplateMap = initializeFileTemplateMap(bakedInput, shader, udimSet.empty() ? EMPTY_STRING : UDIM_TOKEN);
-                input->setValueString(generateTextureFilename(filenameTemplateMap));
+                FilePath filename = generateTextureFilename(filenameTemplateMap);
+                if (!_contentImagePath.isEmpty() && udimSet.empty() && _bakedImageMap.count(output) && !_bakedImageMap[output].empty())
+                {
+                    // Reference the image stored by content.
+                    filename = _bakedImageMap[output][0].filename;
+                }
+                input->setValueString(filename);
 
                 // Reconstruct any world-space nodes that were excluded from the baking process.
                 auto worldSpacePair = _worldSpaceNodes.find(sourceInput->getName());
@@ -510,7 +958,12 @@ DocumentPtr TextureBaker::bakeMaterialToDoc(DocumentPtr doc, const FileSearchPat
         // Always clear any cached implementations before generation.
         genContext.clearNodeImplementations();
 
-        ShaderPtr hwShader = createShader("Shader", genContext, shaderNode);
+        ShaderPtr hwShader;
+        {
+            ScopedTimer generationTimer(&_statistics.generationTime);
+            hwShader = createShader("Shader", genContext, shaderNode);
+            _statistics.generationCount++;
+        }
         if (!hwShader)
         {
             continue;
@@ -540,9 +993,18 @@ void TextureBaker::bakeAllMaterials(DocumentPtr doc, const FileSearchPath& searc
         }
     }
 
+    writeBakedDocuments(bakeAllMaterialsToDocs(doc, searchPath), outputFilename);
+}
+
+BakedDocumentVec TextureBaker::bakeAllMaterialsToDocs(DocumentPtr doc, const FileSearchPath& searchPath)
+{
     std::vector<TypedElementPtr> renderableMaterials;
     findRenderableElements(doc, renderableMaterials);
+    return bakeMaterialsToDocs(doc, searchPath, renderableMaterials);
+}
 
+BakedDocumentVec TextureBaker::bakeMaterialsToDocs(DocumentPtr doc, const FileSearchPath& searchPath, const vector<TypedElementPtr>& materials)
+{
     // Compute the UDIM set.
     ValuePtr udimSetValue = doc->getGeomPropValue("udimset");
     StringVec udimSet;
@@ -553,14 +1015,14 @@ void TextureBaker::bakeAllMaterials(DocumentPtr doc, const FileSearchPath& searc
 
     // Bake all materials in documents to memory.
     BakedDocumentVec bakedDocuments;
-    for (size_t i = 0; i < renderableMaterials.size(); i++)
+    for (size_t i = 0; i < materials.size(); i++)
     {
         if (_outputStream && i > 0)
         {
             *_outputStream << std::endl;
         }
 
-        const TypedElementPtr& element = renderableMaterials[i];
+        const TypedElementPtr& element = materials[i];
         string documentName;
         DocumentPtr bakedMaterialDoc = bakeMaterialToDoc(doc, searchPath, element->getNamePath(), udimSet, documentName);
         if (bakedMaterialDoc)
@@ -568,8 +1030,11 @@ void TextureBaker::bakeAllMaterials(DocumentPtr doc, const FileSearchPath& searc
             bakedDocuments.push_back(make_pair(documentName, bakedMaterialDoc));
         }
     }
+    return bakedDocuments;
+}
 
-    // Write documents in memory to disk.
+void TextureBaker::writeBakedDocuments(const BakedDocumentVec& bakedDocuments, const FilePath& outputFilename)
+{
     size_t bakeCount = bakedDocuments.size();
     for (size_t i = 0; i < bakeCount; i++)
     {